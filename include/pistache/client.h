@@ -16,13 +16,22 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <charconv>
 #include <chrono>
+#include <condition_variable>
 #include <functional>
+#include <limits>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace Pistache {
 namespace Http {
@@ -379,5 +388,766 @@ private:
 
 };
 
+/**
+ * Opt-in request coalescing on top of a Client.
+ *
+ * Concurrent GETs for the same resource share a single request to the
+ * server: the first caller issues it and every caller arriving while it
+ * is in flight gets its own promise settled with the same outcome.
+ * A caller only joins a request that times out no later than its own
+ * timeout would; a caller with a tighter timeout issues a new request,
+ * which later callers join instead. Successful responses are kept in a small cache for as long as their
+ * Cache-Control allows (max-age, no-store, no-cache and private are
+ * honored), or for the default TTL when the server gave no directive.
+ *
+ * Requests made through this class carry no per-request headers, so the
+ * cache key is the method and the resource; responses varying on
+ * anything (Vary: *) are never cached.
+ */
+class CoalescingClient {
+public:
+    struct Options {
+        friend class CoalescingClient;
+
+        Options()
+            : maxEntries_(1024)
+            , defaultTtl_(0)
+        { }
+
+        Options& maxEntries(size_t val) {
+            maxEntries_ = val;
+            return *this;
+        }
+
+        // Lifetime of a response without Cache-Control, 0 disables caching
+        Options& defaultTtl(std::chrono::milliseconds val) {
+            defaultTtl_ = val;
+            return *this;
+        }
+
+    private:
+        size_t maxEntries_;
+        std::chrono::milliseconds defaultTtl_;
+    };
+
+    explicit CoalescingClient(Client& client, const Options& options = Options())
+        : client_(client)
+        , state_(std::make_shared<State>(options))
+    { }
+
+    Async::Promise<Response> get(
+            const std::string& resource,
+            std::chrono::milliseconds timeout = std::chrono::milliseconds(0)) {
+        auto key = std::string(methodString(Method::Get)) + ' ' + resource;
+
+        std::shared_ptr<Flight> flight;
+        bool leader = false;
+        Async::Promise<Response> promise([&](Async::Resolver& resolve, Async::Rejection& reject) {
+            Guard guard(state_->lock);
+
+            auto cached = state_->cache.find(key);
+            if (cached != state_->cache.end()) {
+                if (Clock::now() < cached->second.expiry) {
+                    resolve(Response(cached->second.response));
+                    return;
+                }
+                state_->cache.erase(cached);
+            }
+
+            auto expiry = timeout.count() > 0 ? Clock::now() + timeout : Clock::time_point::max();
+            auto& current = state_->inFlight[key];
+            if (!current || current->expiry > expiry) {
+                current = std::make_shared<Flight>(expiry);
+                leader = true;
+            }
+
+            flight = current;
+            flight->waiters.emplace_back(std::move(resolve), std::move(reject));
+        });
+
+        if (leader) {
+            auto state = state_;
+            client_.get(resource).timeout(timeout).send().then(
+                [state, key, flight](Response response) {
+                    state->complete(key, flight, response);
+                },
+                [state, key, flight](std::exception_ptr exc) {
+                    state->fail(key, flight, exc);
+                });
+        }
+
+        return promise;
+    }
+
+    void clearCache() {
+        Guard guard(state_->lock);
+        state_->cache.clear();
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+    using Lock = std::mutex;
+    using Guard = std::lock_guard<Lock>;
+
+    struct Flight {
+        explicit Flight(Clock::time_point expiry_)
+            : expiry(expiry_)
+            , waiters()
+        { }
+
+        // When the request times out, max() when it has no timeout
+        Clock::time_point expiry;
+        std::vector<std::pair<Async::Resolver, Async::Rejection>> waiters;
+    };
+
+    struct CacheEntry {
+        Response response;
+        Clock::time_point expiry;
+    };
+
+    /* Shared with the pending continuations, so that a response arriving
+       after the CoalescingClient is gone does not touch freed memory */
+    struct State {
+        explicit State(const Options& options_)
+            : options(options_)
+            , lock()
+            , inFlight()
+            , cache()
+        { }
+
+        void complete(const std::string& key, const std::shared_ptr<Flight>& flight, const Response& response) {
+            std::vector<std::pair<Async::Resolver, Async::Rejection>> waiters;
+            {
+                Guard guard(lock);
+                finish(key, flight);
+                waiters.swap(flight->waiters);
+
+                auto ttl = timeToLive(response);
+                if (ttl.count() > 0 && options.maxEntries_ > 0) {
+                    if (cache.size() >= options.maxEntries_)
+                        evict();
+                    cache[key] = CacheEntry { response, Clock::now() + ttl };
+                }
+            }
+
+            // Every waiter gets its own copy, resolving with a const
+            // reference would not match the promise type
+            for (auto& waiter: waiters)
+                waiter.first(Response(response));
+        }
+
+        void fail(const std::string& key, const std::shared_ptr<Flight>& flight, std::exception_ptr exc) {
+            std::vector<std::pair<Async::Resolver, Async::Rejection>> waiters;
+            {
+                Guard guard(lock);
+                finish(key, flight);
+                waiters.swap(flight->waiters);
+            }
+
+            for (auto& waiter: waiters) {
+                try {
+                    std::rethrow_exception(exc);
+                } catch (const Async::Error& e) {
+                    waiter.second(e);
+                } catch (const std::exception& e) {
+                    waiter.second(std::runtime_error(e.what()));
+                } catch (...) {
+                    waiter.second(Async::Error("Request failed"));
+                }
+            }
+        }
+
+        std::chrono::milliseconds timeToLive(const Response& response) const {
+            using std::chrono::milliseconds;
+
+            if (response.code() != Code::Ok)
+                return milliseconds(0);
+
+            auto vary = response.headers().tryGetRaw("Vary");
+            if (!vary.isEmpty() && vary.get().value().find('*') != std::string::npos)
+                return milliseconds(0);
+
+            auto cacheControl = response.headers().tryGet<Header::CacheControl>();
+            if (!cacheControl)
+                return options.defaultTtl_;
+
+            auto ttl = options.defaultTtl_;
+            for (const auto& directive: cacheControl->directives()) {
+                switch (directive.directive()) {
+                case CacheDirective::NoCache:
+                case CacheDirective::NoStore:
+                case CacheDirective::Private:
+                    return milliseconds(0);
+                case CacheDirective::MaxAge:
+                    ttl = std::chrono::duration_cast<milliseconds>(directive.delta());
+                    break;
+                default:
+                    break;
+                }
+            }
+            return ttl;
+        }
+
+        // Must be called with the lock held. The key may already be taken
+        // by a newer request with a tighter timeout.
+        void finish(const std::string& key, const std::shared_ptr<Flight>& flight) {
+            auto it = inFlight.find(key);
+            if (it != inFlight.end() && it->second == flight)
+                inFlight.erase(it);
+        }
+
+        // Must be called with the lock held
+        void evict() {
+            auto now = Clock::now();
+            for (auto it = cache.begin(); it != cache.end();) {
+                if (it->second.expiry <= now)
+                    it = cache.erase(it);
+                else
+                    ++it;
+            }
+            if (cache.size() >= options.maxEntries_)
+                cache.erase(cache.begin());
+        }
+
+        const Options options;
+        Lock lock;
+        std::unordered_map<std::string, std::shared_ptr<Flight>> inFlight;
+        std::unordered_map<std::string, CacheEntry> cache;
+    };
+
+    Client& client_;
+    std::shared_ptr<State> state_;
+};
+
+namespace Header {
+
+/* Remaining time budget of the request, in milliseconds. Set on
+   downstream calls so that the whole call chain shares one deadline */
+class RequestDeadline : public Header {
+public:
+    NAME("X-Request-Deadline")
+
+    RequestDeadline()
+        : budget_(0)
+    { }
+
+    explicit RequestDeadline(std::chrono::milliseconds budget)
+        : budget_(budget)
+    { }
+
+    void parseRaw(const char* str, size_t len) override {
+        long long value = 0;
+        auto res = std::from_chars(str, str + len, value);
+        if (res.ec != std::errc() || value < 0)
+            throw std::runtime_error("Invalid request deadline");
+        budget_ = std::chrono::milliseconds(value);
+    }
+
+    void write(std::ostream& os) const override {
+        os << budget_.count();
+    }
+
+    std::chrono::milliseconds budget() const { return budget_; }
+
+private:
+    std::chrono::milliseconds budget_;
+};
+
+} // namespace Header
+
+/**
+ * Absolute point in time after which an answer is useless.
+ *
+ * A deadline is created once, at the edge (or read from the incoming
+ * request with fromRequest()), and handed down to every downstream call:
+ * each of them gets the time that is left as its timeout and forwards it
+ * in the X-Request-Deadline header.
+ */
+class Deadline {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static Deadline none() {
+        return Deadline(Clock::time_point::max());
+    }
+
+    static Deadline after(std::chrono::milliseconds budget) {
+        return Deadline(Clock::now() + budget);
+    }
+
+    /* Deadline propagated by the caller, or a deadline after 'fallback'
+       when the request does not carry one */
+    static Deadline fromRequest(const Request& request, Deadline fallback = none()) {
+        auto raw = request.headers().tryGetRaw(Header::RequestDeadline::Name);
+        if (raw.isEmpty())
+            return fallback;
+
+        Header::RequestDeadline header;
+        try {
+            auto value = raw.get().value();
+            header.parseRaw(value.data(), value.size());
+        } catch (const std::runtime_error&) {
+            return fallback;
+        }
+
+        return std::min(after(header.budget()), fallback);
+    }
+
+    bool isSet() const {
+        return at_ != Clock::time_point::max();
+    }
+
+    bool expired() const {
+        return isSet() && Clock::now() >= at_;
+    }
+
+    /* Rounded up, so that it is only 0 once the deadline expired */
+    std::chrono::milliseconds remaining() const {
+        if (!isSet())
+            return std::chrono::milliseconds::max();
+
+        auto left = std::chrono::ceil<std::chrono::milliseconds>(at_ - Clock::now());
+        return std::max(left, std::chrono::milliseconds(0));
+    }
+
+    /* Arms the request timeout with what is left and propagates it.
+       A timeout of 0 means none to the RequestBuilder, so a deadline
+       expiring meanwhile still gets 1 ms: callers reject expired
+       deadlines before building the request */
+    RequestBuilder& apply(RequestBuilder& builder) const {
+        if (!isSet())
+            return builder;
+
+        auto left = std::max(remaining(), std::chrono::milliseconds(1));
+        return builder
+            .timeout(left)
+            .header<Header::RequestDeadline>(left);
+    }
+
+    friend bool operator<(const Deadline& lhs, const Deadline& rhs) {
+        return lhs.at_ < rhs.at_;
+    }
+
+private:
+    explicit Deadline(Clock::time_point at)
+        : at_(at)
+    { }
+
+    Clock::time_point at_;
+};
+
+/**
+ * Token bucket bounding the number of retries to a fraction of the
+ * traffic. Every request deposits 'ratio' tokens, every retry withdraws
+ * a whole one: when a downstream service is failing, retries stop once
+ * the budget is spent instead of multiplying the load it receives.
+ */
+class RetryBudget {
+public:
+    explicit RetryBudget(double ratio = 0.1, size_t maxTokens = 10)
+        : ratioMilli_(static_cast<int64_t>(ratio * 1000))
+        , maxMilli_(static_cast<int64_t>(maxTokens) * 1000)
+        , balanceMilli_(maxMilli_)
+    { }
+
+    void deposit() {
+        auto balance = balanceMilli_.load(std::memory_order_relaxed);
+        int64_t next;
+        do {
+            next = std::min(balance + ratioMilli_, maxMilli_);
+        } while (!balanceMilli_.compare_exchange_weak(balance, next, std::memory_order_relaxed));
+    }
+
+    bool tryWithdraw() {
+        auto balance = balanceMilli_.load(std::memory_order_relaxed);
+        do {
+            if (balance < 1000)
+                return false;
+        } while (!balanceMilli_.compare_exchange_weak(balance, balance - 1000, std::memory_order_relaxed));
+        return true;
+    }
+
+private:
+    const int64_t ratioMilli_;
+    const int64_t maxMilli_;
+    std::atomic<int64_t> balanceMilli_;
+};
+
+namespace Private {
+
+/**
+ * One attempt of getWithin() and its retries. Only the original request
+ * deposits into the budget, retries only withdraw.
+ */
+inline Async::Promise<Response> attemptWithin(
+        Client& client, const std::string& resource, Deadline deadline,
+        std::shared_ptr<RetryBudget> budget, int maxAttempts)
+{
+    if (deadline.expired())
+        return Async::Promise<Response>::rejected(Async::Error("Deadline exceeded"));
+
+    auto builder = client.get(resource);
+    auto retry = [&client, resource, deadline, budget, maxAttempts]() {
+        return maxAttempts > 1 && !deadline.expired() && budget->tryWithdraw();
+    };
+
+    return deadline.apply(builder).send().then(
+        [&client, resource, deadline, budget, maxAttempts, retry](Response response) {
+            auto code = response.code();
+            bool retriable = code == Code::Bad_Gateway
+                          || code == Code::Service_Unavailable
+                          || code == Code::Gateway_Timeout;
+            if (retriable && retry())
+                return attemptWithin(client, resource, deadline, budget, maxAttempts - 1);
+
+            return Async::Promise<Response>::resolved(std::move(response));
+        },
+        [&client, resource, deadline, budget, maxAttempts, retry](std::exception_ptr exc) {
+            if (retry())
+                return attemptWithin(client, resource, deadline, budget, maxAttempts - 1);
+
+            try {
+                std::rethrow_exception(exc);
+            } catch (const std::exception& e) {
+                return Async::Promise<Response>::rejected(Async::Error(e.what()));
+            } catch (...) {
+                return Async::Promise<Response>::rejected(Async::Error("Request failed"));
+            }
+        });
+}
+
+} // namespace Private
+
+/**
+ * GET bounded by a deadline, retried on transport errors and on 502, 503
+ * and 504 answers as long as the deadline and the retry budget allow it.
+ */
+inline Async::Promise<Response> getWithin(
+        Client& client, const std::string& resource, Deadline deadline,
+        std::shared_ptr<RetryBudget> budget, int maxAttempts = 3)
+{
+    if (deadline.expired())
+        return Async::Promise<Response>::rejected(Async::Error("Deadline exceeded"));
+
+    budget->deposit();
+    return Private::attemptWithin(client, resource, deadline, std::move(budget), maxAttempts);
+}
+
+/**
+ * Runs tasks after a delay on a thread of its own. Used to send the
+ * second request of getHedged(), the Client has no public timer.
+ * A task is called with true when it is due, or with false when the
+ * timer is destroyed before, so that it can cancel what it was for.
+ */
+class HedgeTimer {
+public:
+    HedgeTimer()
+        : lock()
+        , wakeup()
+        , tasks()
+        , stopping(false)
+        , thread([this]() { run(); })
+    { }
+
+    HedgeTimer(const HedgeTimer& other) = delete;
+    HedgeTimer& operator=(const HedgeTimer& other) = delete;
+
+    /* Pending tasks are cancelled: called with false */
+    ~HedgeTimer() {
+        {
+            Guard guard(lock);
+            stopping = true;
+        }
+        wakeup.notify_one();
+        thread.join();
+
+        for (auto& task: tasks)
+            task.second(false);
+    }
+
+    using Task = std::function<void(bool due)>;
+
+    void schedule(std::chrono::milliseconds delay, Task task) {
+        {
+            Guard guard(lock);
+            tasks.emplace(Clock::now() + delay, std::move(task));
+        }
+        wakeup.notify_one();
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+    using Lock = std::mutex;
+    using Guard = std::lock_guard<Lock>;
+
+    void run() {
+        std::unique_lock<Lock> guard(lock);
+        while (!stopping) {
+            if (tasks.empty()) {
+                wakeup.wait(guard);
+                continue;
+            }
+
+            auto first = tasks.begin();
+            if (Clock::now() < first->first) {
+                wakeup.wait_until(guard, first->first);
+                continue;
+            }
+
+            auto task = std::move(first->second);
+            tasks.erase(first);
+            guard.unlock();
+            task(true);
+            guard.lock();
+        }
+    }
+
+    Lock lock;
+    std::condition_variable wakeup;
+    std::multimap<Clock::time_point, Task> tasks;
+    bool stopping;
+    std::thread thread;
+};
+
+/**
+ * Latencies of the recent successful requests of getHedged(), so that it
+ * hedges after their 95th percentile instead of a fixed delay. The last
+ * Capacity samples are kept; until MinSamples were recorded the initial
+ * delay is used.
+ */
+class LatencyTracker {
+public:
+    static constexpr size_t Capacity = 256;
+    static constexpr size_t MinSamples = 20;
+
+    explicit LatencyTracker(std::chrono::milliseconds initial)
+        : initial_(initial)
+        , samples_()
+        , count_(0)
+    { }
+
+    void record(std::chrono::milliseconds latency) {
+        auto value = std::min<int64_t>(std::max<int64_t>(latency.count(), 0), std::numeric_limits<uint32_t>::max());
+        auto index = count_.fetch_add(1, std::memory_order_relaxed);
+        samples_[index % Capacity].store(static_cast<uint32_t>(value), std::memory_order_relaxed);
+    }
+
+    /* Latency below which 'rank' (0 to 1) of the samples are */
+    std::chrono::milliseconds percentile(double rank) const {
+        auto count = static_cast<size_t>(std::min<uint64_t>(count_.load(std::memory_order_relaxed), Capacity));
+        if (count < MinSamples)
+            return initial_;
+
+        std::array<uint32_t, Capacity> sorted;
+        for (size_t i = 0; i < count; ++i)
+            sorted[i] = samples_[i].load(std::memory_order_relaxed);
+
+        auto nth = sorted.begin() + static_cast<std::ptrdiff_t>(rank * static_cast<double>(count - 1) + 0.5);
+        std::nth_element(sorted.begin(), nth, sorted.begin() + static_cast<std::ptrdiff_t>(count));
+        return std::chrono::milliseconds(*nth);
+    }
+
+    std::chrono::milliseconds hedgeDelay() const {
+        return percentile(0.95);
+    }
+
+private:
+    const std::chrono::milliseconds initial_;
+    std::array<std::atomic<uint32_t>, Capacity> samples_;
+    std::atomic<uint64_t> count_;
+};
+
+namespace Private {
+
+/**
+ * Outcome shared by the requests of getHedged(). The first response
+ * settles the promise and the other one is ignored; the promise is only
+ * rejected once every request sent failed and no other one will be.
+ */
+struct Hedge {
+    Hedge(Async::Resolver resolve_, Async::Rejection reject_, LatencyTracker* latency_)
+        : lock()
+        , resolve(std::move(resolve_))
+        , reject(std::move(reject_))
+        , latency(latency_)
+        , settled(false)
+        , inFlight(1)
+        , hedgePending(true)
+        , failure()
+    { }
+
+    void succeed(Response response) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (settled)
+                return;
+            settled = true;
+        }
+        resolve(std::move(response));
+    }
+
+    void fail(std::exception_ptr exc) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            --inFlight;
+            failure = exc;
+            if (!settleFailed())
+                return;
+        }
+        rejectWith(exc);
+    }
+
+    /* Returns whether the second request must be sent, true once at
+       most. 'allowed' is only asked while nothing answered yet */
+    template<typename Allowed>
+    bool startHedge(Allowed allowed) {
+        std::exception_ptr exc;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (!hedgePending)
+                return false;
+            hedgePending = false;
+            if (!settled && allowed()) {
+                ++inFlight;
+                return true;
+            }
+            if (!settleFailed())
+                return false;
+            exc = failure;
+        }
+        rejectWith(exc);
+        return false;
+    }
+
+    /* Must be called with the lock held */
+    bool settleFailed() {
+        if (settled || inFlight > 0 || hedgePending)
+            return false;
+        settled = true;
+        return true;
+    }
+
+    void rejectWith(std::exception_ptr exc) {
+        try {
+            std::rethrow_exception(exc);
+        } catch (const std::exception& e) {
+            reject(Async::Error(e.what()));
+        } catch (...) {
+            reject(Async::Error("Request failed"));
+        }
+    }
+
+    std::mutex lock;
+    Async::Resolver resolve;
+    Async::Rejection reject;
+    // Latencies of the answers are recorded there, if not null
+    LatencyTracker* latency;
+    bool settled;
+    int inFlight;
+    bool hedgePending;
+    std::exception_ptr failure;
+};
+
+inline void sendHedged(
+        Client& client, const std::string& resource, Deadline deadline,
+        std::shared_ptr<RetryBudget> budget, std::shared_ptr<Hedge> hedge, bool primary);
+
+/* Sends the hedge if it is still pending and 'due', and the deadline and
+   the budget allow it. Otherwise the hedge is given up */
+inline void startHedge(
+        Client& client, const std::string& resource, Deadline deadline,
+        std::shared_ptr<RetryBudget> budget, std::shared_ptr<Hedge> hedge, bool due)
+{
+    auto allowed = [due, &deadline, &budget]() {
+        return due && !deadline.expired() && budget->tryWithdraw();
+    };
+    if (hedge->startHedge(allowed))
+        sendHedged(client, resource, deadline, std::move(budget), std::move(hedge), false);
+}
+
+/* A failed primary request does not wait for the hedge delay, the hedge
+   is sent right away */
+inline void sendHedged(
+        Client& client, const std::string& resource, Deadline deadline,
+        std::shared_ptr<RetryBudget> budget, std::shared_ptr<Hedge> hedge, bool primary)
+{
+    auto builder = client.get(resource);
+    auto sent = Deadline::Clock::now();
+    deadline.apply(builder).send().then(
+        [hedge, sent](Response response) {
+            if (hedge->latency)
+                hedge->latency->record(std::chrono::duration_cast<std::chrono::milliseconds>(Deadline::Clock::now() - sent));
+            hedge->succeed(std::move(response));
+        },
+        [&client, resource, deadline, budget, hedge, primary](std::exception_ptr exc) {
+            hedge->fail(exc);
+            if (primary)
+                startHedge(client, resource, deadline, budget, hedge, true);
+        });
+}
+
+} // namespace Private
+
+namespace Private {
+
+inline Async::Promise<Response> getHedged(
+        Client& client, const std::string& resource, Deadline deadline,
+        std::chrono::milliseconds hedgeDelay, LatencyTracker* latency,
+        std::shared_ptr<RetryBudget> budget, HedgeTimer& timer)
+{
+    if (deadline.expired())
+        return Async::Promise<Response>::rejected(Async::Error("Deadline exceeded"));
+
+    budget->deposit();
+
+    std::shared_ptr<Hedge> hedge;
+    Async::Promise<Response> promise([&](Async::Resolver& resolve, Async::Rejection& reject) {
+        hedge = std::make_shared<Hedge>(std::move(resolve), std::move(reject), latency);
+    });
+
+    sendHedged(client, resource, deadline, budget, hedge, true);
+    timer.schedule(hedgeDelay, [&client, resource, deadline, budget, hedge](bool due) {
+        // A cancelled hedge is never sent, a failure seen so far is final
+        startHedge(client, resource, deadline, budget, hedge, due);
+    });
+
+    return promise;
+}
+
+} // namespace Private
+
+/**
+ * GET bounded by a deadline that sends the same request a second time
+ * when the first one has not answered after hedgeDelay, chosen by the
+ * caller, and settles with whichever answers first. A primary request
+ * that fails sends the hedge at once instead of waiting. The hedge is
+ * only sent if the deadline allows it and the retry budget has a token
+ * for it, so hedging cannot multiply the load of a slow service. Only
+ * meant for idempotent resources.
+ *
+ * The losing request is not cancelled: its answer is ignored, but it
+ * holds its connection until it completes or times out (connections are
+ * only reachable from client.cc).
+ */
+inline Async::Promise<Response> getHedged(
+        Client& client, const std::string& resource, Deadline deadline,
+        std::chrono::milliseconds hedgeDelay, std::shared_ptr<RetryBudget> budget,
+        HedgeTimer& timer)
+{
+    return Private::getHedged(client, resource, deadline, hedgeDelay, nullptr, std::move(budget), timer);
+}
+
+/**
+ * Same as above, hedging after the 95th percentile of the latencies
+ * recorded in 'latency', which must outlive the request.
+ */
+inline Async::Promise<Response> getHedged(
+        Client& client, const std::string& resource, Deadline deadline,
+        LatencyTracker& latency, std::shared_ptr<RetryBudget> budget,
+        HedgeTimer& timer)
+{
+    return Private::getHedged(client, resource, deadline, latency.hedgeDelay(), &latency, std::move(budget), timer);
+}
+
 } // namespace Http
 } // namespace Pistache
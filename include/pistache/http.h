@@ -158,6 +158,11 @@ public:
 
     std::string body() const;
 
+    /* The body without copying it, valid as long as the request. */
+    const std::string& rawBody() const {
+        return body_;
+    }
+
     const Header::Collection& headers() const;
     const Uri::Query& query() const;
 
@@ -445,6 +450,7 @@ public:
     static constexpr size_t DefaultStreamSize = 512;
 
     friend Async::Promise<ssize_t> serveFile(ResponseWriter&, const std::string&, const Mime::MediaType&);
+    friend Async::Promise<ssize_t> serveFile(ResponseWriter&, const FileBuffer&, const Mime::MediaType&);
 
     friend class Handler;
     friend class Timeout;
@@ -497,17 +503,7 @@ public:
             const std::string& body,
             const Mime::MediaType &mime = Mime::MediaType())
     {
-        code_ = code;
-
-        if (mime.isValid()) {
-            auto contentType = headers_.tryGet<Header::ContentType>();
-            if (contentType)
-                contentType->setMime(mime);
-            else
-                headers_.add(std::make_shared<Header::ContentType>(mime));
-        }
-
-        return putOnWire(body.c_str(), body.size());
+        return send(code, body.data(), body.size(), mime);
     }
 
     template<size_t N>
@@ -516,7 +512,18 @@ public:
             const char (&arr)[N],
             const Mime::MediaType& mime = Mime::MediaType())
     {
-        /* @Refactor: code duplication */
+        return send(code, arr, N - 1, mime);
+    }
+
+    /* The body is serialized into the response buffer before returning,
+       so it may live in storage that does not outlive this call (a
+       per-request arena for example). */
+    Async::Promise<ssize_t> send(
+            Code code,
+            const char* data,
+            size_t size,
+            const Mime::MediaType& mime = Mime::MediaType())
+    {
         code_ = code;
 
         if (mime.isValid()) {
@@ -527,7 +534,7 @@ public:
                 headers_.add(std::make_shared<Header::ContentType>(mime));
         }
 
-        return putOnWire(arr, N - 1);
+        return putOnWire(data, size);
     }
 
     ResponseStream stream(Code code, size_t streamSize = DefaultStreamSize) {
@@ -606,6 +613,52 @@ Async::Promise<ssize_t> serveFile(
         ResponseWriter& response, const std::string& fileName,
         const Mime::MediaType& contentType = Mime::MediaType());
 
+/* Serves a file that is already opened (e.g kept in a cache of open
+   descriptors). The head of the response is written first, then the
+   content is handed to the transport which sends it with sendfile(),
+   straight from the page cache. The descriptor must stay open until
+   the returned promise is settled.
+*/
+inline Async::Promise<ssize_t> serveFile(
+        ResponseWriter& response, const FileBuffer& file,
+        const Mime::MediaType& contentType = Mime::MediaType())
+{
+    if (contentType.isValid())
+        response.setMime(contentType);
+
+    response.code_ = Code::Ok;
+
+    auto *buf = response.rdbuf();
+    std::ostream os(buf);
+
+    os << response.version() << ' '
+       << static_cast<int>(Code::Ok) << ' ' << codeString(Code::Ok) << crlf;
+
+    for (const auto& header: response.headers().list()) {
+        os << header->name() << ": ";
+        header->write(os);
+        os << crlf;
+    }
+    for (const auto& raw: response.headers().rawList()) {
+        os << raw.second.name() << ": " << raw.second.value() << crlf;
+    }
+
+    os << "Content-Length: " << file.size() << crlf;
+    os << crlf;
+
+    if (!os)
+        return Async::Promise<ssize_t>::rejected(
+                std::runtime_error("Response exceeded buffer size"));
+
+    auto *transport = response.transport_;
+    auto sockFd = response.peer()->fd();
+
+    return transport->asyncWrite(sockFd, buf->buffer(), MSG_MORE).then(
+        [=](ssize_t) {
+            return transport->asyncWrite(sockFd, file);
+        }, Async::Throw);
+}
+
 namespace Private {
 
     enum class State { Again, Next, Done };
@@ -11,7 +11,11 @@
 #include <stdexcept>
 
 #include <array>
+#include <cstdint>
+#include <utility>
 #include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 #include <unistd.h>
 
 #include <pistache/common.h>
@@ -411,6 +415,76 @@ public:
 
     }
 
+    /*
+     * Enqueues up to count elements from [first, first + count) and returns
+     * how many were enqueued (less than count when the queue fills up).
+     * The free cells are checked first and the whole range is then claimed
+     * with a single CAS, instead of one per element.
+     */
+    template<typename InputIt>
+    size_t enqueueBulk(InputIt first, size_t count) {
+        size_t index = enqueueIndex.load(std::memory_order_relaxed);
+        size_t claimed;
+        for (;;) {
+            std::intptr_t diff = 0;
+            for (claimed = 0; claimed < count; ++claimed) {
+                size_t seq = cell(index + claimed)->sequence.load(std::memory_order_acquire);
+                diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(index + claimed);
+                if (diff != 0)
+                    break;
+            }
+
+            if (claimed == 0) {
+                if (diff < 0 || count == 0) return 0;
+                index = enqueueIndex.load(std::memory_order_relaxed);
+            }
+            else if (enqueueIndex.compare_exchange_weak
+                    (index, index + claimed, std::memory_order_relaxed))
+                break;
+        }
+
+        for (size_t i = 0; i < claimed; ++i, ++first) {
+            Cell* target = cell(index + i);
+            target->data = *first;
+            target->sequence.store(index + i + 1, std::memory_order_release);
+        }
+        return claimed;
+    }
+
+    /*
+     * Dequeues up to maxCount elements into out and returns how many were
+     * dequeued. Like enqueueBulk(), the range is claimed with a single CAS.
+     */
+    template<typename OutputIt>
+    size_t dequeueBulk(OutputIt out, size_t maxCount) {
+        size_t index = dequeueIndex.load(std::memory_order_relaxed);
+        size_t claimed;
+        for (;;) {
+            std::intptr_t diff = 0;
+            for (claimed = 0; claimed < maxCount; ++claimed) {
+                size_t seq = cell(index + claimed)->sequence.load(std::memory_order_acquire);
+                diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(index + claimed + 1);
+                if (diff != 0)
+                    break;
+            }
+
+            if (claimed == 0) {
+                if (diff < 0 || maxCount == 0) return 0;
+                index = dequeueIndex.load(std::memory_order_relaxed);
+            }
+            else if (dequeueIndex.compare_exchange_weak
+                    (index, index + claimed, std::memory_order_relaxed))
+                break;
+        }
+
+        for (size_t i = 0; i < claimed; ++i, ++out) {
+            Cell* target = cell(index + i);
+            *out = std::move(target->data);
+            target->sequence.store(index + i + Mask + 1, std::memory_order_release);
+        }
+        return claimed;
+    }
+
 private:
     struct Cell {
         Cell()
@@ -438,4 +512,144 @@ private:
     std::atomic<size_t> dequeueIndex;
 };
 
+/*
+ * A MPMCQueue with blocking operations: a consumer waiting on an empty
+ * queue (or a producer waiting on a full one) first spins for a while,
+ * which is enough when the other side is active, and then sleeps on a
+ * futex. The non-blocking operations of the underlying queue are still
+ * available and wake up sleepers as well.
+ */
+template<typename T, size_t Size>
+class BlockingMPMCQueue {
+public:
+    static constexpr int DefaultSpins = 128;
+
+    BlockingMPMCQueue()
+        : queue_()
+        , notEmpty_()
+        , notFull_()
+    { }
+
+    BlockingMPMCQueue(const BlockingMPMCQueue& other) = delete;
+    BlockingMPMCQueue& operator=(const BlockingMPMCQueue& other) = delete;
+
+    template<typename U>
+    bool tryEnqueue(U&& data) {
+        if (!queue_.enqueue(std::forward<U>(data)))
+            return false;
+
+        notEmpty_.notify();
+        return true;
+    }
+
+    bool tryDequeue(T& data) {
+        if (!queue_.dequeue(data))
+            return false;
+
+        notFull_.notify();
+        return true;
+    }
+
+    template<typename InputIt>
+    size_t tryEnqueueBulk(InputIt first, size_t count) {
+        size_t n = queue_.enqueueBulk(first, count);
+        if (n > 0)
+            notEmpty_.notify();
+        return n;
+    }
+
+    template<typename OutputIt>
+    size_t tryDequeueBulk(OutputIt out, size_t maxCount) {
+        size_t n = queue_.dequeueBulk(out, maxCount);
+        if (n > 0)
+            notFull_.notify();
+        return n;
+    }
+
+    template<typename U>
+    void enqueue(U&& data, int spins = DefaultSpins) {
+        // The value is only moved from when the enqueue succeeds
+        notFull_.wait([&] { return tryEnqueue(std::forward<U>(data)); }, spins);
+    }
+
+    void dequeue(T& data, int spins = DefaultSpins) {
+        notEmpty_.wait([&] { return tryDequeue(data); }, spins);
+    }
+
+    /* Blocks until at least one element is available, then returns as
+       many as possible, up to maxCount */
+    template<typename OutputIt>
+    size_t dequeueBulk(OutputIt out, size_t maxCount, int spins = DefaultSpins) {
+        size_t n = 0;
+        notEmpty_.wait([&] { return (n = tryDequeueBulk(out, maxCount)) > 0; }, spins);
+        return n;
+    }
+
+private:
+    /* Futex based event. The sequence number changes on every
+       notification, a waiter only goes to sleep if it did not change
+       since its last failed attempt, so no wake-up can be missed */
+    class Event {
+    public:
+        Event()
+            : seq()
+            , waiters()
+        {
+            seq.store(0, std::memory_order_relaxed);
+            waiters.store(0, std::memory_order_relaxed);
+        }
+
+        void notify() {
+            seq.fetch_add(1, std::memory_order_seq_cst);
+            if (waiters.load(std::memory_order_seq_cst) > 0)
+                futex(FUTEX_WAKE_PRIVATE, INT32_MAX);
+        }
+
+        template<typename Attempt>
+        void wait(Attempt attempt, int spins) {
+            for (int i = 0; i < spins; ++i) {
+                if (attempt()) return;
+                cpuRelax();
+            }
+
+            for (;;) {
+                waiters.fetch_add(1, std::memory_order_seq_cst);
+                uint32_t current = seq.load(std::memory_order_seq_cst);
+                if (attempt()) {
+                    waiters.fetch_sub(1, std::memory_order_seq_cst);
+                    return;
+                }
+                futex(FUTEX_WAIT_PRIVATE, current);
+                waiters.fetch_sub(1, std::memory_order_seq_cst);
+
+                if (attempt()) return;
+            }
+        }
+
+    private:
+        static void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#elif defined(__aarch64__)
+            asm volatile("yield");
+#endif
+        }
+
+        void futex(int op, uint32_t val) {
+            ::syscall(SYS_futex, reinterpret_cast<uint32_t *>(&seq), op, val, nullptr, nullptr, 0);
+        }
+
+        std::atomic<uint32_t> seq;
+        std::atomic<uint32_t> waiters;
+    };
+
+    MPMCQueue<T, Size> queue_;
+
+    cacheline_pad_t pad0;
+    Event notEmpty_;
+
+    cacheline_pad_t pad1;
+    Event notFull_;
+};
+
 } // namespace Pistache
@@ -0,0 +1,271 @@
+/* resolver.h
+
+   Asynchronous host name resolution with a cache
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <netdb.h>
+#include <sys/socket.h>
+
+#include <pistache/async.h>
+#include <pistache/net.h>
+
+namespace Pistache {
+
+/**
+ * Resolves host names on a helper thread so that callers (typically
+ * reactor threads) never block in getaddrinfo().
+ *
+ * Answers are cached: successful ones for Options::ttl, "no such host"
+ * ones for Options::negativeTtl. Concurrent lookups of the same name
+ * share a single getaddrinfo() call. Since getaddrinfo() goes through
+ * nsswitch, /etc/hosts and the resolvers of /etc/resolv.conf are honored.
+ *
+ * Addresses are returned IPv6 and IPv4 interleaved (RFC 8305 section 4),
+ * so that a caller trying them in order alternates between families.
+ *
+ * Promises are settled on the helper thread, or synchronously on a cache
+ * hit.
+ */
+class HostResolver {
+public:
+    struct Options {
+        friend class HostResolver;
+
+        Options()
+            : ttl_(std::chrono::seconds(30))
+            , negativeTtl_(std::chrono::seconds(5))
+            , maxEntries_(1024)
+        { }
+
+        Options& ttl(std::chrono::milliseconds val) {
+            ttl_ = val;
+            return *this;
+        }
+
+        Options& negativeTtl(std::chrono::milliseconds val) {
+            negativeTtl_ = val;
+            return *this;
+        }
+
+        Options& maxEntries(size_t val) {
+            maxEntries_ = val;
+            return *this;
+        }
+
+    private:
+        std::chrono::milliseconds ttl_;
+        std::chrono::milliseconds negativeTtl_;
+        size_t maxEntries_;
+    };
+
+    explicit HostResolver(const Options& options = Options())
+        : options_(options)
+        , lock_()
+        , cond_()
+        , queue_()
+        , pending_()
+        , cache_()
+        , stop_(false)
+        , thread_()
+    {
+        thread_ = std::thread([this] { run(); });
+    }
+
+    HostResolver(const HostResolver& other) = delete;
+    HostResolver& operator=(const HostResolver& other) = delete;
+
+    ~HostResolver() {
+        {
+            Guard guard(lock_);
+            stop_ = true;
+        }
+        cond_.notify_one();
+        thread_.join();
+
+        for (auto& entry: pending_) {
+            for (auto& waiter: entry.second)
+                waiter.second(Error("Resolver stopped"));
+        }
+    }
+
+    Async::Promise<std::vector<Address>> resolve(const std::string& host, Port port) {
+        auto key = host + ':' + port.toString();
+        bool enqueue = false;
+
+        auto promise = Async::Promise<std::vector<Address>>(
+            [&](Async::Resolver& resolve, Async::Rejection& reject) {
+                Guard guard(lock_);
+
+                auto cached = cache_.find(key);
+                if (cached != cache_.end()) {
+                    if (Clock::now() < cached->second.expiry) {
+                        if (cached->second.addresses.empty())
+                            reject(Error(cached->second.error));
+                        else
+                            resolve(std::vector<Address>(cached->second.addresses));
+                        return;
+                    }
+                    cache_.erase(cached);
+                }
+
+                auto& waiters = pending_[key];
+                enqueue = waiters.empty();
+                waiters.emplace_back(std::move(resolve), std::move(reject));
+                if (enqueue)
+                    queue_.emplace_back(key, Query { host, port });
+            });
+
+        if (enqueue)
+            cond_.notify_one();
+
+        return promise;
+    }
+
+    void clear() {
+        Guard guard(lock_);
+        cache_.clear();
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+    using Lock = std::mutex;
+    using Guard = std::lock_guard<Lock>;
+    using Waiter = std::pair<Async::Resolver, Async::Rejection>;
+
+    struct Query {
+        std::string host;
+        Port port;
+    };
+
+    struct Entry {
+        std::vector<Address> addresses;
+        std::string error;
+        Clock::time_point expiry;
+    };
+
+    void run() {
+        for (;;) {
+            std::pair<std::string, Query> next;
+            {
+                std::unique_lock<Lock> guard(lock_);
+                cond_.wait(guard, [this] { return stop_ || !queue_.empty(); });
+                if (stop_)
+                    return;
+
+                next = std::move(queue_.front());
+                queue_.pop_front();
+            }
+
+            Entry entry;
+            bool cacheable = lookup(next.second, entry);
+
+            std::vector<Waiter> waiters;
+            {
+                Guard guard(lock_);
+                waiters.swap(pending_[next.first]);
+                pending_.erase(next.first);
+
+                if (cacheable) {
+                    if (cache_.size() >= options_.maxEntries_)
+                        evict();
+                    cache_[next.first] = entry;
+                }
+            }
+
+            for (auto& waiter: waiters) {
+                if (entry.addresses.empty())
+                    waiter.second(Error(entry.error));
+                else
+                    waiter.first(std::vector<Address>(entry.addresses));
+            }
+        }
+    }
+
+    /* Returns whether the answer may be cached: transient failures
+       (EAI_AGAIN, out of memory, ...) are not */
+    bool lookup(const Query& query, Entry& entry) const {
+        struct addrinfo hints;
+        std::memset(&hints, 0, sizeof hints);
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = AI_ADDRCONFIG;
+
+        AddrInfo info;
+        const auto port = query.port.toString();
+        int res = info.invoke(query.host.c_str(), port.c_str(), &hints);
+        if (res != 0) {
+            entry.error = gai_strerror(res);
+            entry.expiry = Clock::now() + options_.negativeTtl_;
+            return res == EAI_NONAME
+#ifdef EAI_NODATA
+                || res == EAI_NODATA
+#endif
+                ;
+        }
+
+        std::vector<Address> v6, v4;
+        for (auto *addr = info.get_info_ptr(); addr; addr = addr->ai_next) {
+            if (addr->ai_family == AF_INET6)
+                v6.push_back(Address::fromUnix(addr->ai_addr));
+            else if (addr->ai_family == AF_INET)
+                v4.push_back(Address::fromUnix(addr->ai_addr));
+        }
+
+        for (size_t i = 0; i < std::max(v6.size(), v4.size()); ++i) {
+            if (i < v6.size())
+                entry.addresses.push_back(std::move(v6[i]));
+            if (i < v4.size())
+                entry.addresses.push_back(std::move(v4[i]));
+        }
+
+        if (entry.addresses.empty()) {
+            entry.error = "No usable address";
+            entry.expiry = Clock::now() + options_.negativeTtl_;
+        }
+        else
+            entry.expiry = Clock::now() + options_.ttl_;
+
+        return true;
+    }
+
+    // Must be called with the lock held
+    void evict() {
+        auto now = Clock::now();
+        for (auto it = cache_.begin(); it != cache_.end();) {
+            if (it->second.expiry <= now)
+                it = cache_.erase(it);
+            else
+                ++it;
+        }
+        if (!cache_.empty() && cache_.size() >= options_.maxEntries_)
+            cache_.erase(cache_.begin());
+    }
+
+    const Options options_;
+
+    Lock lock_;
+    std::condition_variable cond_;
+    std::deque<std::pair<std::string, Query>> queue_;
+    std::unordered_map<std::string, std::vector<Waiter>> pending_;
+    std::unordered_map<std::string, Entry> cache_;
+    bool stop_;
+
+    std::thread thread_;
+};
+
+} // namespace Pistache
@@ -6,9 +6,17 @@
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <mutex>
 #include <regex>
+#include <stdexcept>
+#include <sstream>
 #include <string>
 #include <tuple>
+#include <type_traits>
 #include <unordered_map>
 #include <memory>
 #include <vector>
@@ -25,7 +33,7 @@ namespace Rest {
 class Description;
 
 namespace details {
-template<typename T>
+template<typename T, typename Enable = void>
 struct LexicalCast {
     static T cast(const std::string& value) {
         std::istringstream iss(value);
@@ -34,6 +42,11 @@ struct LexicalCast {
             throw std::runtime_error("Bad lexical cast");
          return out;
     }
+
+    static bool tryCast(const std::string& value, T& out) {
+        std::istringstream iss(value);
+        return static_cast<bool>(iss >> out);
+    }
 };
 
 template<>
@@ -41,7 +54,69 @@ struct LexicalCast<std::string> {
     static std::string cast(const std::string& value) {
         return value;
     }
+
+    static bool tryCast(const std::string& value, std::string& out) {
+        out = value;
+        return true;
+    }
+};
+
+/* Arithmetic types do not need a stream: std::from_chars parses them
+   in place, without allocating and without looking at the locale.
+   Leading blanks and a leading '+' are skipped and trailing characters
+   are ignored, which is what the stream based cast used to accept. A '+'
+   must be followed by a digit (or by a point and a digit for floating
+   point types), from_chars would otherwise accept a second sign. */
+template<typename T>
+struct FromCharsCast {
+    static T cast(const std::string& value) {
+        T out;
+        if (!tryCast(value, out))
+            throw std::runtime_error("Bad lexical cast");
+        return out;
+    }
+
+    static bool tryCast(const std::string& value, T& out) {
+        const char* first = value.data();
+        const char* last = first + value.size();
+
+        while (first != last && std::isspace(static_cast<unsigned char>(*first)))
+            ++first;
+        if (first != last && *first == '+') {
+            ++first;
+            const char* digit = first;
+            if (std::is_floating_point<T>::value && digit != last && *digit == '.')
+                ++digit;
+            if (digit == last || !std::isdigit(static_cast<unsigned char>(*digit)))
+                return false;
+        }
+
+        return std::from_chars(first, last, out).ec == std::errc();
+    }
 };
+
+/* Character types are read as a character by the stream, not as a
+   number, and wide ones have no from_chars overload. */
+template<typename T>
+struct IsCharacter : std::integral_constant<bool,
+        std::is_same<T, char>::value || std::is_same<T, signed char>::value ||
+        std::is_same<T, unsigned char>::value || std::is_same<T, wchar_t>::value ||
+        std::is_same<T, char16_t>::value || std::is_same<T, char32_t>::value> { };
+
+template<typename T>
+struct LexicalCast<T, typename std::enable_if<
+        std::is_integral<T>::value && !std::is_same<T, bool>::value &&
+        !IsCharacter<T>::value>::type>
+    : public FromCharsCast<T> { };
+
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+// Floating point overloads of std::from_chars are not available on every
+// standard library, fall back to the stream when they are missing.
+template<typename T>
+struct LexicalCast<T, typename std::enable_if<
+        std::is_floating_point<T>::value>::type>
+    : public FromCharsCast<T> { };
+#endif
 }  // namespace details
 
 class TypedParam {
@@ -56,6 +131,13 @@ public:
         return details::LexicalCast<T>::cast(value_);
     }
 
+    /* Same as as() without exceptions: returns false, leaving 'out'
+       unspecified, when the value does not parse */
+    template<typename T>
+    bool tryAs(T& out) const {
+        return details::LexicalCast<T>::tryCast(value_, out);
+    }
+
     const std::string& name() const {
         return name_;
     }
@@ -86,6 +168,7 @@ struct Route {
 
 namespace Private {
     class RouterHandler;
+    class SnapshotRouterHandler;
 }
 
 /**
@@ -253,6 +336,193 @@ private:
     Route::Handler notFoundHandler;
 };
 
+/**
+ * A router whose routes can be added and removed while other threads
+ * are routing requests through it.
+ *
+ * Writers are serialized and never touch a table that is being read:
+ * every modification builds a brand new Router from the list of
+ * registered routes and publishes it as the current snapshot. Readers
+ * (see Private::SnapshotRouterHandler) never lock, they only compare
+ * the published generation with the one of the snapshot they hold and
+ * reload it when it changed. An old snapshot is released as soon as the
+ * last worker routing on it has moved to a newer one.
+ */
+class SnapshotRouter {
+public:
+    SnapshotRouter()
+      : writeLock()
+      , entries()
+      , customHandlers()
+      , notFoundHandler()
+      , current(std::make_shared<Table>())
+      , generation_(0)
+    { }
+
+    SnapshotRouter(const SnapshotRouter& other) = delete;
+    SnapshotRouter& operator=(const SnapshotRouter& other) = delete;
+
+    void get(const std::string& resource, Route::Handler handler) {
+        addRoute(Http::Method::Get, resource, std::move(handler));
+    }
+    void post(const std::string& resource, Route::Handler handler) {
+        addRoute(Http::Method::Post, resource, std::move(handler));
+    }
+    void put(const std::string& resource, Route::Handler handler) {
+        addRoute(Http::Method::Put, resource, std::move(handler));
+    }
+    void patch(const std::string& resource, Route::Handler handler) {
+        addRoute(Http::Method::Patch, resource, std::move(handler));
+    }
+    void del(const std::string& resource, Route::Handler handler) {
+        addRoute(Http::Method::Delete, resource, std::move(handler));
+    }
+    void options(const std::string& resource, Route::Handler handler) {
+        addRoute(Http::Method::Options, resource, std::move(handler));
+    }
+
+    /**
+     * Removes the route associated to a given method and resource.
+     * \throws std::runtime_error No such route was registered
+     */
+    void removeRoute(Http::Method method, const std::string& resource) {
+        Guard guard(writeLock);
+
+        auto next = entries;
+        auto it = std::find_if(next.begin(), next.end(), [&](const Entry& entry) {
+            return entry.method == method && entry.resource == resource;
+        });
+        if (it == next.end())
+            throw std::runtime_error("Requested route does not exist.");
+
+        next.erase(it);
+        publish(std::move(next), customHandlers, notFoundHandler);
+    }
+
+    void addCustomHandler(Route::Handler handler) {
+        Guard guard(writeLock);
+
+        auto next = customHandlers;
+        next.push_back(std::move(handler));
+        publish(entries, std::move(next), notFoundHandler);
+    }
+
+    void addNotFoundHandler(Route::Handler handler) {
+        Guard guard(writeLock);
+        publish(entries, customHandlers, std::move(handler));
+    }
+
+    /**
+     * Returns the currently published routing table. The returned Router
+     * may be shared by several workers. Router::route() is not read-only
+     * (it inserts an empty table for a method without routes), so the
+     * snapshot must only be routed through the handler, which never asks
+     * it for such a method.
+     */
+    std::shared_ptr<Router> snapshot() const {
+        auto table = std::atomic_load_explicit(&current, std::memory_order_acquire);
+        return std::shared_ptr<Router>(table, &table->router);
+    }
+
+    /**
+     * Monotonic counter incremented every time a new snapshot is
+     * published. Cheap enough to be checked on every request.
+     */
+    uint64_t generation() const {
+        return generation_.load(std::memory_order_acquire);
+    }
+
+    static std::shared_ptr<Private::SnapshotRouterHandler>
+    handler(std::shared_ptr<SnapshotRouter> router);
+
+private:
+    friend class Private::SnapshotRouterHandler;
+
+    using Lock = std::mutex;
+    using Guard = std::lock_guard<Lock>;
+
+    /* A published Router and the methods it has at least one route for,
+       one bit per Http::Method. */
+    struct Table {
+        Router router;
+        uint32_t methods = 0;
+
+        bool routes(Http::Method method) const {
+            return (methods & (1u << static_cast<unsigned>(method))) != 0;
+        }
+    };
+
+    struct Entry {
+        Http::Method method;
+        std::string resource;
+        Route::Handler handler;
+    };
+
+    void addRoute(Http::Method method, const std::string& resource,
+                  Route::Handler handler) {
+        Guard guard(writeLock);
+
+        auto next = entries;
+        next.push_back(Entry { method, resource, std::move(handler) });
+        publish(std::move(next), customHandlers, notFoundHandler);
+    }
+
+    /* Must be called with writeLock held. The new table is fully built
+       before anything is committed, so an invalid route (which makes
+       Router throw) leaves the published snapshot untouched. */
+    void publish(std::vector<Entry> nextEntries,
+                 std::vector<Route::Handler> nextCustomHandlers,
+                 Route::Handler nextNotFoundHandler) {
+        auto table = std::make_shared<Table>();
+        auto router = &table->router;
+
+        for (const auto& entry: nextEntries) {
+            switch (entry.method) {
+            case Http::Method::Get:
+                router->get(entry.resource, entry.handler);
+                break;
+            case Http::Method::Post:
+                router->post(entry.resource, entry.handler);
+                break;
+            case Http::Method::Put:
+                router->put(entry.resource, entry.handler);
+                break;
+            case Http::Method::Patch:
+                router->patch(entry.resource, entry.handler);
+                break;
+            case Http::Method::Delete:
+                router->del(entry.resource, entry.handler);
+                break;
+            case Http::Method::Options:
+                router->options(entry.resource, entry.handler);
+                break;
+            default:
+                throw std::runtime_error("Unsupported route method");
+            }
+            table->methods |= 1u << static_cast<unsigned>(entry.method);
+        }
+        for (const auto& handler: nextCustomHandlers)
+            router->addCustomHandler(handler);
+        if (nextNotFoundHandler)
+            router->addNotFoundHandler(nextNotFoundHandler);
+
+        entries = std::move(nextEntries);
+        customHandlers = std::move(nextCustomHandlers);
+        notFoundHandler = std::move(nextNotFoundHandler);
+
+        std::atomic_store_explicit(&current, std::move(table), std::memory_order_release);
+        generation_.fetch_add(1, std::memory_order_release);
+    }
+
+    Lock writeLock;
+    std::vector<Entry> entries;
+    std::vector<Route::Handler> customHandlers;
+    Route::Handler notFoundHandler;
+
+    std::shared_ptr<Table> current;
+    std::atomic<uint64_t> generation_;
+};
+
 namespace Private {
 
     class RouterHandler : public Http::Handler {
@@ -283,6 +553,62 @@ namespace Private {
 
         std::shared_ptr<Rest::Router> router;
     };
+
+    /**
+     * Routes requests against the snapshots published by a
+     * SnapshotRouter. Every worker gets its own clone, hence its own
+     * cached snapshot, so the read side never writes to shared memory.
+     */
+    class SnapshotRouterHandler : public Http::Handler {
+    public:
+        explicit SnapshotRouterHandler(std::shared_ptr<Rest::SnapshotRouter> router)
+            : router(std::move(router))
+            , snapshot()
+            , generation(0)
+        { }
+
+        void onRequest(
+                const Http::Request& req,
+                Http::ResponseWriter response) override {
+            auto current = router->generation();
+            if (!snapshot || current != generation) {
+                snapshot = std::atomic_load_explicit(&router->current, std::memory_order_acquire);
+                generation = current;
+            }
+
+            /* Router::route() would insert a table for a method without
+               routes into the shared snapshot, such requests go straight
+               to the not-found path (custom handlers are not tried). */
+            auto result = Route::Status::NotFound;
+            if (snapshot->routes(req.method())) {
+                auto resp = response.clone();
+                result = snapshot->router.route(req, std::move(resp));
+            }
+
+            if (result == Route::Status::NotFound) {
+                if (snapshot->router.hasNotFoundHandler()) {
+                    auto resp2 = response.clone();
+                    snapshot->router.invokeNotFoundHandler(req, std::move(resp2));
+                }
+                else
+                    response.send(Http::Code::Not_Found, "Could not find a matching route");
+            }
+        }
+
+    private:
+        std::shared_ptr<Tcp::Handler> clone() const final {
+            return std::make_shared<SnapshotRouterHandler>(router);
+        }
+
+        std::shared_ptr<Rest::SnapshotRouter> router;
+        std::shared_ptr<Rest::SnapshotRouter::Table> snapshot;
+        uint64_t generation;
+    };
+}
+
+inline std::shared_ptr<Private::SnapshotRouterHandler>
+SnapshotRouter::handler(std::shared_ptr<SnapshotRouter> router) {
+    return std::make_shared<Private::SnapshotRouterHandler>(std::move(router));
 }
 
 class Request : public Http::Request {
@@ -318,6 +644,50 @@ namespace Routes {
 
     void NotFound(Router& router, Route::Handler handler);
 
+    namespace details {
+        /* Answers 413 if the body of the request is larger than maxSize. */
+        inline bool rejectPayload(size_t maxSize, const Rest::Request& request, Http::ResponseWriter& response) {
+            auto contentLength = request.headers().tryGet<Http::Header::ContentLength>();
+            size_t size = contentLength ? contentLength->value() : request.rawBody().size();
+            if (size <= maxSize)
+                return false;
+
+            response.send(Http::Code::Request_Entity_Too_Large, "Request payload is too large");
+            return true;
+        }
+    }
+
+    /**
+     * Wraps a handler so that requests with a body larger than maxSize
+     * are answered with 413 instead of reaching it.
+     *
+     * This limits what reaches the handler, not memory: the body is
+     * buffered by the parser before routing, up to the endpoint limit
+     * (Endpoint::Options::maxPayload), which therefore bounds every route.
+     */
+    inline Route::Handler limitPayload(size_t maxSize, Route::Handler handler) {
+        return [=](const Rest::Request& request, Http::ResponseWriter response) {
+            if (details::rejectPayload(maxSize, request, response))
+                return Route::Result::Ok;
+
+            return handler(request, std::move(response));
+        };
+    }
+
+    /**
+     * Same as above for a member function, called without going through
+     * a second Route::Handler, which would copy the request again.
+     */
+    template<typename Result, typename Cls, typename... Args, typename Obj>
+    Route::Handler limitPayload(size_t maxSize, Result (Cls::*func)(Args...), Obj obj) {
+        return [=](const Rest::Request& request, Http::ResponseWriter response) {
+            if (!details::rejectPayload(maxSize, request, response))
+                (obj->*func)(request, std::move(response));
+
+            return Route::Result::Ok;
+        };
+    }
+
     namespace details {
         template <class... Args>
         struct TypeList
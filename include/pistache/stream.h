@@ -161,6 +161,14 @@ struct FileBuffer {
 
     FileBuffer(const std::string& fileName);
 
+    /* Wraps a file that is already opened. The descriptor is not owned,
+       it must stay open until every write using this buffer completed */
+    FileBuffer(std::string fileName, Fd fd, size_t size)
+        : fileName_(std::move(fileName))
+        , fd_(fd)
+        , size_(size)
+    { }
+
     std::string fileName() const { return fileName_; }
     Fd fd() const { return fd_; }
     size_t size() const { return size_; }
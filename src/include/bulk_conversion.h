@@ -0,0 +1,285 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "number_format.h"
+#include "number_parser.h"
+#include "unit_expression.h"
+
+
+
+// Bulk conversion of a CSV or NDJSON document.
+// Rows are taken in blocks: a block is parsed first, runs of rows sharing the
+// same (from, to) pair are converted with a single batch call and the block
+// is then formatted. Output is produced one block at a time, so the caller
+// decides how much of it is buffered.
+//
+// CSV rows are "value,from,to", or just "value" when the units are fixed for
+// the whole document. A first row whose value is not a number is taken as a
+// header. NDJSON rows are objects with "value", "from" and "to" fields.
+// Units may be unit expressions.
+// Output has one line per input row, in the same order.
+template<class _converter>
+class bulk_conversion
+{
+public:
+	constexpr static std::size_t block_size = 1024;
+
+	enum class format { csv, ndjson };
+
+	// 'from' and 'to' are the units of rows not giving their own, they may be
+	// empty. 'input' must outlive the conversion.
+	bulk_conversion(std::string_view input, format input_format, std::string_view from, std::string_view to,
+		number_format output_format = number_format()) :
+		m_input(input),
+		m_format(input_format),
+		m_from(from),
+		m_to(to),
+		m_output_format(output_format),
+		m_first_row(true)
+	{
+		;
+	}
+
+	bool done() const
+	{
+		return m_input.empty();
+	}
+
+	// Input not converted yet.
+	std::string_view remaining() const
+	{
+		return m_input;
+	}
+
+	// Go on with 'input', a copy of remaining() that outlives the
+	// conversion, when the original input is about to go away.
+	void relocate(std::string_view input)
+	{
+		m_input = input;
+	}
+
+	// Convert the next block of rows, appending the result to 'output'.
+	void next(std::string & output)
+	{
+		std::size_t count = 0;
+		while (count < block_size && !m_input.empty())
+		{
+			auto line = next_line();
+			if (line.empty())
+				continue;
+
+			if (parse_row(line, m_rows[count]))
+				++count;
+		}
+
+		convert(count);
+		format_rows(count, output);
+	}
+
+private:
+	enum class status { ok, invalid_value, unknown_conversion };
+
+	struct row
+	{
+		float value;
+		std::string_view from;
+		std::string_view to;
+		status state;
+	};
+
+	std::string_view next_line()
+	{
+		auto end = m_input.find('\n');
+		auto line = m_input.substr(0, end);
+		m_input.remove_prefix(end == std::string_view::npos ? m_input.size() : end + 1);
+
+		return trim(line);
+	}
+
+	// Returns false when the row must be skipped (CSV header).
+	bool parse_row(std::string_view line, row & current)
+	{
+		bool first_row = m_first_row;
+		m_first_row = false;
+
+		std::string_view value;
+		current.from = m_from;
+		current.to = m_to;
+
+		if (m_format == format::csv)
+		{
+			auto comma = line.find(',');
+			value = trim(line.substr(0, comma));
+			if (comma != std::string_view::npos)
+			{
+				line.remove_prefix(comma + 1);
+				comma = line.find(',');
+				auto from = trim(line.substr(0, comma));
+				auto to = comma == std::string_view::npos ? std::string_view() : trim(line.substr(comma + 1));
+				if (!from.empty())
+					current.from = from;
+				if (!to.empty())
+					current.to = to;
+			}
+		}
+		else
+		{
+			value = json_field(line, "value").value_or(std::string_view());
+			current.from = json_field(line, "from").value_or(m_from);
+			current.to = json_field(line, "to").value_or(m_to);
+		}
+
+		current.state = number_parser::parse(value, current.value) ? status::ok : status::invalid_value;
+		if (first_row && m_format == format::csv && current.state == status::invalid_value)
+		{
+			m_header = true;
+			return false;
+		}
+		return true;
+	}
+
+	// Convert runs of rows sharing the same units with one batch call each.
+	void convert(std::size_t count)
+	{
+		for (std::size_t first = 0; first < count;)
+		{
+			if (m_rows[first].state != status::ok)
+			{
+				++first;
+				continue;
+			}
+
+			std::size_t last = first + 1;
+			while (last < count && m_rows[last].state == status::ok &&
+				m_rows[last].from == m_rows[first].from && m_rows[last].to == m_rows[first].to)
+				++last;
+
+			auto plan = unit_expression<_converter>::plan(m_rows[first].from, m_rows[first].to);
+			if (!plan)
+			{
+				for (std::size_t i = first; i < last; ++i)
+					m_rows[i].state = status::unknown_conversion;
+			}
+			else
+			{
+				for (std::size_t i = first; i < last; ++i)
+					m_values[i] = m_rows[i].value;
+				plan->convert(&m_values[first], &m_results[first], last - first);
+			}
+
+			first = last;
+		}
+	}
+
+	void format_rows(std::size_t count, std::string & output)
+	{
+		if (m_header)
+		{
+			output += "result\n";
+			m_header = false;
+		}
+
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			const char * error = nullptr;
+			if (m_rows[i].state == status::invalid_value)
+				error = "Invalid value!";
+			else if (m_rows[i].state == status::unknown_conversion)
+				error = "Unknown conversion type!";
+			// Outside the domain of a non-linear unit (dB of a negative ratio).
+			else if (!std::isfinite(m_results[i]))
+				error = "Invalid value!";
+
+			if (m_format == format::csv)
+			{
+				// Failed rows are left empty.
+				if (!error)
+					m_output_format.append(output, m_results[i]);
+				output += '\n';
+			}
+			else if (error)
+			{
+				output += "{\"error\":\"";
+				output += error;
+				output += "\"}\n";
+			}
+			else
+			{
+				output += "{\"result\":\"";
+				m_output_format.append(output, m_results[i]);
+				output += "\"}\n";
+			}
+		}
+	}
+
+	// Value of a top level field of a flat JSON object: the content of a
+	// string, or the raw text of any other value. Escapes are not decoded,
+	// they cannot appear in numbers or unit names.
+	static std::optional<std::string_view> json_field(std::string_view object, std::string_view key)
+	{
+		std::size_t position = 0;
+		while ((position = object.find('"', position)) != std::string_view::npos)
+		{
+			auto name_end = object.find('"', position + 1);
+			if (name_end == std::string_view::npos)
+				return std::nullopt;
+
+			auto name = object.substr(position + 1, name_end - position - 1);
+			position = object.find_first_not_of(" \t", name_end + 1);
+			if (position == std::string_view::npos || object[position] != ':')
+				continue;
+
+			position = object.find_first_not_of(" \t", position + 1);
+			if (position == std::string_view::npos)
+				return std::nullopt;
+
+			std::string_view value;
+			if (object[position] == '"')
+			{
+				auto value_end = object.find('"', position + 1);
+				if (value_end == std::string_view::npos)
+					return std::nullopt;
+				value = object.substr(position + 1, value_end - position - 1);
+				position = value_end + 1;
+			}
+			else
+			{
+				auto value_end = object.find_first_of(",}", position);
+				value = trim(object.substr(position, value_end - position));
+				position = value_end;
+			}
+
+			if (name == key)
+				return value;
+		}
+		return std::nullopt;
+	}
+
+	static std::string_view trim(std::string_view text)
+	{
+		while (!text.empty() && (text.front() == ' ' || text.front() == '\t'))
+			text.remove_prefix(1);
+		while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r'))
+			text.remove_suffix(1);
+		return text;
+	}
+
+	std::string_view m_input;
+	format m_format;
+	std::string_view m_from;
+	std::string_view m_to;
+	number_format m_output_format;
+	bool m_first_row;
+	bool m_header = false;
+
+	std::array<row, block_size> m_rows;
+	alignas(64) std::array<float, block_size> m_values;
+	alignas(64) std::array<float, block_size> m_results;
+};
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "pistache/http.h"
+
+
+
+// Chunked response with bounded memory.
+// Every chunk handed to the transport is accounted as pending until the
+// socket accepted it. Once pending bytes pass the high-water mark, write()
+// reports it and the producer waits on drained(), which is resolved when the
+// backlog falls back under half the mark. A slow client therefore holds at
+// most about one high-water mark of buffered output, whatever the size of
+// the response.
+class chunked_stream : public std::enable_shared_from_this<chunked_stream>
+{
+public:
+	constexpr static std::size_t default_high_water_mark = 256 * 1024;
+
+	// Start a chunked response. The status line and headers of 'response'
+	// are sent right away.
+	static std::shared_ptr<chunked_stream> open(Pistache::Http::ResponseWriter & response, Pistache::Http::Code code,
+		std::size_t high_water_mark = default_high_water_mark)
+	{
+		auto peer = response.peer();
+		auto stream = response.stream(code);
+		stream.flush();
+
+		return std::shared_ptr<chunked_stream>(new chunked_stream(std::move(stream), std::move(peer), high_water_mark));
+	}
+
+	chunked_stream(const chunked_stream &) = delete;
+	chunked_stream & operator=(const chunked_stream &) = delete;
+
+	// Queue one chunk. Returns false once the producer should stop and wait
+	// for drained(); the chunk itself is queued unless the client went
+	// away, in which case it is dropped and drained() rejects.
+	bool write(const char * data, std::size_t size)
+	{
+		if (failed())
+			return false;
+		if (size == 0)
+			return writable();
+
+		char head[24];
+		int head_size = snprintf(head, sizeof head, "%zx\r\n", size);
+
+		std::string chunk;
+		chunk.reserve(static_cast<std::size_t>(head_size) + size + 2);
+		chunk.append(head, static_cast<std::size_t>(head_size));
+		chunk.append(data, size);
+		chunk.append("\r\n", 2);
+
+		send(chunk);
+		return writable();
+	}
+
+	bool write(const std::string & data)
+	{
+		return write(data.data(), data.size());
+	}
+
+	// Resolved once pending bytes are back under half the high-water mark.
+	// Rejected if the client went away.
+	Pistache::Async::Promise<void> drained()
+	{
+		std::lock_guard<std::mutex> guard(m_lock);
+
+		if (m_failed)
+			return Pistache::Async::Promise<void>::rejected(std::runtime_error("Write failed: Broken pipe"));
+		if (m_pending.load(std::memory_order_acquire) <= low_water_mark())
+			return Pistache::Async::Promise<void>::resolved();
+
+		return Pistache::Async::Promise<void>([this](Pistache::Async::Deferred<void> deferred)
+		{
+			m_waiters.push_back(std::move(deferred));
+		});
+	}
+
+	// Terminate the response with the last (empty) chunk.
+	void end()
+	{
+		m_stream.ends();
+	}
+
+	bool writable() const
+	{
+		return m_pending.load(std::memory_order_acquire) < m_high_water_mark;
+	}
+
+	std::size_t pending() const
+	{
+		return m_pending.load(std::memory_order_acquire);
+	}
+
+	// The client went away, nothing written is delivered any more.
+	bool failed() const
+	{
+		return m_failed.load(std::memory_order_acquire);
+	}
+
+private:
+	chunked_stream(Pistache::Http::ResponseStream && stream, std::shared_ptr<Pistache::Tcp::Peer> peer, std::size_t high_water_mark) :
+		m_stream(std::move(stream)),
+		m_peer(std::move(peer)),
+		m_high_water_mark(high_water_mark),
+		m_pending(0)
+	{
+		;
+	}
+
+	std::size_t low_water_mark() const
+	{
+		return m_high_water_mark / 2;
+	}
+
+	// The transport copies the buffer before it returns, the promise is
+	// resolved once the socket took all of it.
+	void send(const std::string & chunk)
+	{
+		auto self = shared_from_this();
+		std::size_t size = chunk.size();
+
+		m_pending.fetch_add(size, std::memory_order_acq_rel);
+		m_peer->send(Pistache::Buffer(chunk.data(), chunk.size())).then(
+			[self, size](ssize_t) { self->on_sent(size); },
+			[self, size](std::exception_ptr) { self->on_failed(size); });
+	}
+
+	void on_sent(std::size_t size)
+	{
+		auto pending = m_pending.fetch_sub(size, std::memory_order_acq_rel) - size;
+		if (pending > low_water_mark())
+			return;
+
+		std::vector<Pistache::Async::Deferred<void>> waiters;
+		{
+			std::lock_guard<std::mutex> guard(m_lock);
+			waiters.swap(m_waiters);
+		}
+		for (auto & waiter : waiters)
+			waiter.resolve();
+	}
+
+	void on_failed(std::size_t size)
+	{
+		m_pending.fetch_sub(size, std::memory_order_acq_rel);
+
+		std::vector<Pistache::Async::Deferred<void>> waiters;
+		{
+			std::lock_guard<std::mutex> guard(m_lock);
+			m_failed.store(true, std::memory_order_release);
+			waiters.swap(m_waiters);
+		}
+		for (auto & waiter : waiters)
+			waiter.reject(std::runtime_error("Write failed: Broken pipe"));
+	}
+
+	Pistache::Http::ResponseStream m_stream;
+	std::shared_ptr<Pistache::Tcp::Peer> m_peer;
+	std::size_t m_high_water_mark;
+
+	std::atomic<std::size_t> m_pending;
+	std::mutex m_lock;
+	std::atomic<bool> m_failed{ false };
+	std::vector<Pistache::Async::Deferred<void>> m_waiters;
+};
@@ -1,12 +1,120 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <iterator>
+#include <limits>
 #include <string>
+#include <string_view>
 #include <memory>
 #include <tuple>
 #include <optional>
+#include <ratio>
+#include <utility>
 
+#include "unit_lexicon.h"
 
 
+
+// Non-linear step of a conversion plan.
+// Curves are immutable and live as long as the process, plans only point
+// to them.
+struct curve
+{
+	virtual ~curve() = default;
+
+	virtual float apply(float value) const = 0;
+
+	// Apply to a block of values, in place if 'values' == 'results'.
+	virtual void apply(const float * values, float * results, std::size_t count) const = 0;
+};
+
+// Conversion plan.
+// Any chain of linear conversions and unit prefixes folds into one affine
+// transform, applied with a multiply-add per value. Non-linear conversions
+// add curve stages, each followed by its own affine transform, so a chain
+// through a primary unit has at most two of them.
+struct conversion_plan
+{
+	constexpr static std::size_t max_stages = 2;
+
+	struct stage
+	{
+		const curve * shape;
+		float factor;
+		float offset;
+	};
+
+	float factor = 1.f;
+	float offset = 0.f;
+	std::array<stage, max_stages> stages{};
+	std::size_t stage_count = 0;
+
+	bool is_linear() const
+	{
+		return stage_count == 0;
+	}
+
+	float convert(float value) const
+	{
+		value = factor * value + offset;
+		for (std::size_t i = 0; i < stage_count; ++i)
+			value = stages[i].factor * stages[i].shape->apply(value) + stages[i].offset;
+		return value;
+	}
+
+	// Convert a block of values, the affine loops are vectorized.
+	void convert(const float * values, float * results, std::size_t count) const
+	{
+		affine(values, results, count, factor, offset);
+		for (std::size_t i = 0; i < stage_count; ++i)
+		{
+			stages[i].shape->apply(results, results, count);
+			affine(results, results, count, stages[i].factor, stages[i].offset);
+		}
+	}
+
+	// This plan followed by 'next'.
+	conversion_plan then(const conversion_plan & next) const
+	{
+		if (stage_count + next.stage_count > max_stages)
+			throw "Too many non-linear conversions in a plan!";
+
+		conversion_plan result = *this;
+		float & last_factor = result.stage_count ? result.stages[result.stage_count - 1].factor : result.factor;
+		float & last_offset = result.stage_count ? result.stages[result.stage_count - 1].offset : result.offset;
+		last_offset = next.factor * last_offset + next.offset;
+		last_factor = next.factor * last_factor;
+
+		for (std::size_t i = 0; i < next.stage_count; ++i)
+			result.stages[result.stage_count++] = next.stages[i];
+		return result;
+	}
+
+	// Plan for values given in 'from_scale' units, giving results in
+	// 'to_scale' units (SI prefixes).
+	conversion_plan scaled(double from_scale, double to_scale) const
+	{
+		conversion_plan result = *this;
+		float & last_factor = result.stage_count ? result.stages[result.stage_count - 1].factor : result.factor;
+		float & last_offset = result.stage_count ? result.stages[result.stage_count - 1].offset : result.offset;
+
+		result.factor = static_cast<float>(result.factor * from_scale);
+		last_factor = static_cast<float>(last_factor / to_scale);
+		last_offset = static_cast<float>(last_offset / to_scale);
+		return result;
+	}
+
+private:
+	static void affine(const float * values, float * results, std::size_t count, float factor, float offset)
+	{
+		for (std::size_t i = 0; i < count; ++i)
+			results[i] = factor * values[i] + offset;
+	}
+};
+
 // Basic conversion class.
 struct conversion { virtual ~conversion() = default; };
 
@@ -41,12 +149,263 @@ public:
 		return (value - m_offset) * m_divider;
 	}
 
+	conversion_plan forward_plan() const
+	{
+		return { m_factor, m_offset };
+	}
+
+	conversion_plan backward_plan() const
+	{
+		return { m_divider, -m_offset * m_divider };
+	}
+
 private:
 	float m_factor;
 	float m_divider;
 	float m_offset;
 };
 
+// Affine transform y = factor * x + offset with exact rational coefficients
+// (std::ratio), for conversions computed in fixed point.
+template<class _factor, class _offset = std::ratio<0>>
+struct exact_affine
+{
+	using factor = typename _factor::type;
+	using offset = typename _offset::type;
+
+	using inverse = exact_affine<
+		std::ratio_divide<std::ratio<1>, factor>,
+		std::ratio_divide<std::ratio_subtract<std::ratio<0>, offset>, factor>>;
+};
+
+// Linear conversion defined by exact rationals, the float transform is
+// derived from them. 'exact_forward' and 'exact_backward' are the
+// transforms of forward() and backward().
+template<class _factor, class _offset = std::ratio<0>>
+class exact_linear : public linear
+{
+public:
+	using exact_forward = exact_affine<_factor, _offset>;
+	using exact_backward = typename exact_forward::inverse;
+
+	exact_linear() : linear(value<_factor>(), value<_offset>()) { ; }
+
+private:
+	template<class _ratio>
+	constexpr static float value()
+	{
+		return static_cast<float>(static_cast<double>(_ratio::num) / static_cast<double>(_ratio::den));
+	}
+};
+
+// Closed form curves of the logarithmic conversions.
+struct exp2_curve : public curve
+{
+	static const exp2_curve instance;
+
+	float apply(float value) const
+	{
+		return std::exp2(value);
+	}
+
+	void apply(const float * values, float * results, std::size_t count) const
+	{
+		for (std::size_t i = 0; i < count; ++i)
+			results[i] = std::exp2(values[i]);
+	}
+};
+inline const exp2_curve exp2_curve::instance{};
+
+struct log2_curve : public curve
+{
+	static const log2_curve instance;
+
+	float apply(float value) const
+	{
+		return std::log2(value);
+	}
+
+	void apply(const float * values, float * results, std::size_t count) const
+	{
+		for (std::size_t i = 0; i < count; ++i)
+			results[i] = std::log2(values[i]);
+	}
+};
+inline const log2_curve log2_curve::instance{};
+
+// Logarithmic conversion class.
+// basic = scale * base ^ (exponent * derivative + shift), as for decibels,
+// pH or wire gauges. Computed as exp2 of an affine transform, so the curve
+// is the only non-linear step.
+class logarithmic : public conversion
+{
+public:
+	logarithmic() = delete;
+
+	logarithmic(double scale, double base, double exponent, double shift = 0.)
+	{
+		if (scale <= 0. || base <= 0. || base == 1. || exponent == 0.)
+			throw "Invalid logarithmic conversion!";
+
+		m_factor = static_cast<float>(exponent * std::log2(base));
+		m_offset = static_cast<float>(shift * std::log2(base));
+		m_scale = static_cast<float>(scale);
+	}
+
+	// Convert from derivative value to basic one.
+	float forward(float value) const
+	{
+		return m_scale * std::exp2(m_factor * value + m_offset);
+	}
+
+	// Convert from basic value to derivative one.
+	float backward(float value) const
+	{
+		return (std::log2(value / m_scale) - m_offset) / m_factor;
+	}
+
+	conversion_plan forward_plan() const
+	{
+		conversion_plan plan{ m_factor, m_offset };
+		plan.stages[plan.stage_count++] = { &exp2_curve::instance, m_scale, 0.f };
+		return plan;
+	}
+
+	conversion_plan backward_plan() const
+	{
+		conversion_plan plan{ 1.f / m_scale, 0.f };
+		plan.stages[plan.stage_count++] = { &log2_curve::instance, 1.f / m_factor, -m_offset / m_factor };
+		return plan;
+	}
+
+private:
+	float m_factor;
+	float m_offset;
+	float m_scale;
+};
+
+// Piecewise linear curve resampled on a uniform grid, so that interpolation
+// is an index computation instead of a search. Values outside of the table
+// give NaN.
+class table_curve : public curve
+{
+public:
+	constexpr static std::size_t size = 1024;
+
+	// 'points' are (x, y) pairs, monotonic in both x and y. With 'inverse'
+	// the curve maps y to x.
+	template<std::size_t _count>
+	table_curve(const std::array<std::pair<float, float>, _count> & points, bool inverse)
+	{
+		static_assert(_count >= 2, "A table needs at least two points");
+
+		std::array<std::pair<float, float>, _count> sorted = points;
+		if (inverse)
+		{
+			for (auto & point : sorted)
+				point = { point.second, point.first };
+		}
+		if (sorted.front().first > sorted.back().first)
+			std::reverse(sorted.begin(), sorted.end());
+
+		m_first = sorted.front().first;
+		m_last = sorted.back().first;
+		float step = (sorted.back().first - m_first) / (size - 1);
+		m_inverse_step = 1.f / step;
+
+		std::size_t segment = 0;
+		for (std::size_t i = 0; i < size; ++i)
+		{
+			float x = m_first + step * i;
+			while (segment + 2 < _count && x > sorted[segment + 1].first)
+				++segment;
+
+			const auto & [x0, y0] = sorted[segment];
+			const auto & [x1, y1] = sorted[segment + 1];
+			m_values[i] = y0 + (x - x0) * (y1 - y0) / (x1 - x0);
+		}
+	}
+
+	float apply(float value) const
+	{
+		return interpolate(value);
+	}
+
+	// Same arithmetic as apply(), without branches, so the loop is
+	// vectorized with gathers where the target has them.
+	void apply(const float * values, float * results, std::size_t count) const
+	{
+		for (std::size_t i = 0; i < count; ++i)
+			results[i] = interpolate(values[i]);
+	}
+
+private:
+	float interpolate(float value) const
+	{
+		float position = (value - m_first) * m_inverse_step;
+		position = std::fmin(std::fmax(position, 0.f), static_cast<float>(size - 1));
+
+		std::size_t index = static_cast<std::size_t>(position);
+		index = index < size - 2 ? index : size - 2;
+		float fraction = position - static_cast<float>(index);
+
+		float result = m_values[index] + fraction * (m_values[index + 1] - m_values[index]);
+		return value >= m_first && value <= m_last ? result : std::numeric_limits<float>::quiet_NaN();
+	}
+
+	alignas(64) std::array<float, size> m_values;
+	float m_first;
+	float m_last;
+	float m_inverse_step;
+};
+
+// Tabulated conversion class.
+// '_table::points()' holds (derivative, basic) pairs of a monotonic curve
+// known only by measurements, such as a thermocouple response.
+template<class _table>
+class tabulated : public conversion
+{
+public:
+	// Convert from derivative value to basic one.
+	float forward(float value) const
+	{
+		return forward_curve().apply(value);
+	}
+
+	// Convert from basic value to derivative one.
+	float backward(float value) const
+	{
+		return backward_curve().apply(value);
+	}
+
+	conversion_plan forward_plan() const
+	{
+		conversion_plan plan;
+		plan.stages[plan.stage_count++] = { &forward_curve(), 1.f, 0.f };
+		return plan;
+	}
+
+	conversion_plan backward_plan() const
+	{
+		conversion_plan plan;
+		plan.stages[plan.stage_count++] = { &backward_curve(), 1.f, 0.f };
+		return plan;
+	}
+
+private:
+	static const table_curve & forward_curve()
+	{
+		static const table_curve curve(_table::points(), false);
+		return curve;
+	}
+
+	static const table_curve & backward_curve()
+	{
+		static const table_curve curve(_table::points(), true);
+		return curve;
+	}
+};
+
 
 // Metrics.
 // Weight metrics.
@@ -59,30 +418,48 @@ using weight_metrics = std::tuple<gramm, lb, pood>;
 struct meter { constexpr static char const * signature = "m"; };
 struct mile { constexpr static char const * signature = "ml"; };
 struct verst { constexpr static char const * signature = "v"; };
-using distance_metrics = std::tuple<meter, mile, verst>;
+struct wire_gauge { constexpr static char const * signature = "awg"; };
+using distance_metrics = std::tuple<meter, mile, verst, wire_gauge>;
 
 // Temperature metrics.
 struct celsius { constexpr static char const * signature = "c"; };
 struct fahrenheit { constexpr static char const * signature = "f"; };
 struct kelvin { constexpr static char const * signature = "k"; };
-using temperature_metrics = std::tuple<celsius, fahrenheit, kelvin>;
+struct type_k_thermocouple { constexpr static char const * signature = "typek"; };
+using temperature_metrics = std::tuple<celsius, fahrenheit, kelvin, type_k_thermocouple>;
+
+// Power ratio metrics.
+struct power_ratio { constexpr static char const * signature = "ratio"; };
+struct decibel { constexpr static char const * signature = "dB"; };
+using power_ratio_metrics = std::tuple<power_ratio, decibel>;
+
+// Acidity metrics.
+struct hydrogen_ion { constexpr static char const * signature = "cH"; };
+struct ph { constexpr static char const * signature = "pH"; };
+using acidity_metrics = std::tuple<hydrogen_ion, ph>;
 
 // Possible conversion types.
 template<class _primary, class _minor>
 struct metric_conversion_type;
 
 // Weight.
-template<> struct metric_conversion_type<gramm, lb> : public linear { metric_conversion_type() : linear(453.592f) { ; } };
-template<> struct metric_conversion_type<gramm, pood> : public linear { metric_conversion_type() : linear(16'380.7f) { ; } };
+template<> struct metric_conversion_type<gramm, lb> : public exact_linear<std::ratio<453'592, 1'000>> { };
+template<> struct metric_conversion_type<gramm, pood> : public exact_linear<std::ratio<163'807, 10>> { };
 
 // Distance.
-template<> struct metric_conversion_type<meter, mile> : public linear { metric_conversion_type() : linear(1'609.34f) { ; } };
-template<> struct metric_conversion_type<meter, verst> : public linear { metric_conversion_type() : linear(1'066.8f) { ; } };
+template<> struct metric_conversion_type<meter, mile> : public exact_linear<std::ratio<160'934, 100>> { };
+template<> struct metric_conversion_type<meter, verst> : public exact_linear<std::ratio<10'668, 10>> { };
+// American wire gauge diameter: 0.127 mm * 92 ^ ((36 - n) / 39).
+template<> struct metric_conversion_type<meter, wire_gauge> : public logarithmic
+{
+	metric_conversion_type() : logarithmic(0.000127, 92., -1. / 39., 36. / 39.) { ; }
+};
 
 // Temperature.
-template<> struct metric_conversion_type<celsius, fahrenheit> : public linear
+template<> struct metric_conversion_type<celsius, fahrenheit> : public exact_linear<std::ratio<9, 5>, std::ratio<32>>
 {
-	metric_conversion_type() : linear(9.f / 5.f, 32.f) { ; }
+	using exact_forward = exact_linear::exact_backward;
+	using exact_backward = exact_linear::exact_forward;
 
 	// Convert from basic value to derivative one.
 	float forward(float value) const
@@ -95,8 +472,77 @@ template<> struct metric_conversion_type<celsius, fahrenheit> : public linear
 	{
 		return linear::forward(value);
 	}
+
+	conversion_plan forward_plan() const
+	{
+		return linear::backward_plan();
+	}
+
+	conversion_plan backward_plan() const
+	{
+		return linear::forward_plan();
+	}
+};
+template<> struct metric_conversion_type<celsius, kelvin> : public exact_linear<std::ratio<1>, std::ratio<-27'315, 100>> { };
+// Type K thermocouple voltage (mV, 0 c reference junction), from the
+// NIST ITS-90 reference functions, tabulated every 10 c from -270 to 1372 c.
+struct type_k_table
+{
+	constexpr static std::size_t count = 166;
+
+	static const std::array<std::pair<float, float>, count> & points()
+	{
+		static const auto table = []()
+		{
+			std::array<std::pair<float, float>, count> result{};
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				double celsius = i + 1 < count ? -270. + 10. * static_cast<double>(i) : 1'372.;
+				result[i] = { static_cast<float>(millivolts(celsius)), static_cast<float>(celsius) };
+			}
+			return result;
+		}();
+		return table;
+	}
+
+	// E(t) = sum(c[i] * t^i), plus a0 * exp(a1 * (t - a2)^2) above 0 c.
+	static double millivolts(double celsius)
+	{
+		constexpr double below_zero[] = { 0., 3.9450128025e-2, 2.3622373598e-5, -3.2858906784e-7,
+			-4.9904828777e-9, -6.7509059173e-11, -5.7410327428e-13, -3.1088872894e-15,
+			-1.0451609365e-17, -1.9889266878e-20, -1.6322697486e-23 };
+		constexpr double above_zero[] = { -1.7600413686e-2, 3.8921204975e-2, 1.8558770032e-5,
+			-9.9457592874e-8, 3.1840945719e-10, -5.6072844889e-13, 5.6075059059e-16,
+			-3.2020720003e-19, 9.7151147152e-23, -1.2104721275e-26 };
+
+		double result = 0.;
+		if (celsius < 0.)
+		{
+			for (std::size_t i = std::size(below_zero); i-- > 0;)
+				result = result * celsius + below_zero[i];
+		}
+		else
+		{
+			for (std::size_t i = std::size(above_zero); i-- > 0;)
+				result = result * celsius + above_zero[i];
+			result += 0.118597600 * std::exp(-1.183432e-4 * (celsius - 126.9686) * (celsius - 126.9686));
+		}
+		return result;
+	}
+};
+template<> struct metric_conversion_type<celsius, type_k_thermocouple> : public tabulated<type_k_table> { };
+
+// Power ratio: 10 ^ (dB / 10).
+template<> struct metric_conversion_type<power_ratio, decibel> : public logarithmic
+{
+	metric_conversion_type() : logarithmic(1., 10., 0.1) { ; }
+};
+
+// Acidity: [H+] = 10 ^ -pH mol/L.
+template<> struct metric_conversion_type<hydrogen_ion, ph> : public logarithmic
+{
+	metric_conversion_type() : logarithmic(1., 10., -1.) { ; }
 };
-template<> struct metric_conversion_type<celsius, kelvin> : public linear { metric_conversion_type() : linear(1.f, 273.15f) { ; } };
 
 
 // Conversion factory.
@@ -143,6 +589,16 @@ struct primary_metrics_converter
 		else
 			return converter_factory::instance()->converter<_primary, _minor>().backward(value);
 	}
+
+	conversion_plan plan() const
+	{
+		if constexpr (std::is_same<_primary, _minor>::value)
+			return {};
+		else if constexpr (_direction)
+			return converter_factory::instance()->converter<_primary, _minor>().forward_plan();
+		else
+			return converter_factory::instance()->converter<_primary, _minor>().backward_plan();
+	}
 };
 
 // Minor/minor.
@@ -159,8 +615,21 @@ struct minor_metrics_converter
 		else
 		{
 			const auto & factory = converter_factory::instance();
-			return factory->converter<_primary, _second_minor>().forward(
-				factory->converter<_primary, _first_minor>().backward(value)
+			return factory->converter<_primary, _first_minor>().backward(
+				factory->converter<_primary, _second_minor>().forward(value)
+			);
+		}
+	}
+
+	conversion_plan plan() const
+	{
+		if constexpr (std::is_same<_first_minor, _second_minor>::value)
+			return {};
+		else
+		{
+			const auto & factory = converter_factory::instance();
+			return factory->converter<_primary, _second_minor>().forward_plan().then(
+				factory->converter<_primary, _first_minor>().backward_plan()
 			);
 		}
 	}
@@ -179,7 +648,14 @@ public:
 		m_next = std::move(next);
 	}
 
-	virtual std::optional<float> process(const std::string & from, const std::string & to, float value) = 0;
+	virtual std::optional<float> process(std::string_view from, std::string_view to, float value) = 0;
+
+	// Find the actor responsible for the conversion, nullptr if none is.
+	// Resolving once lets a batch of values skip the chain walk.
+	virtual const responsible * find(std::string_view from, std::string_view to) const = 0;
+
+	// Single affine transform performing the conversion.
+	virtual conversion_plan plan() const = 0;
 
 protected:
 	std::unique_ptr<responsible> m_next;
@@ -191,7 +667,7 @@ class responsible_impl : public responsible
 {
 public:
 	//responsible_impl() = default;
-	std::optional<float> process(const std::string & from, const std::string & to, float value)
+	std::optional<float> process(std::string_view from, std::string_view to, float value)
 	{
 		if (is_reponsible(from, to))
 			return m_converter.convert(value);
@@ -201,7 +677,22 @@ public:
 			return std::nullopt;
 	}
 
-	bool is_reponsible(const std::string & from, const std::string & to) const
+	const responsible * find(std::string_view from, std::string_view to) const
+	{
+		if (is_reponsible(from, to))
+			return this;
+		else if (m_next)
+			return m_next->find(from, to);
+		else
+			return nullptr;
+	}
+
+	conversion_plan plan() const
+	{
+		return m_converter.plan();
+	}
+
+	bool is_reponsible(std::string_view from, std::string_view to) const
 	{
 		return (_metrics_converter::from_signature == from) &&
 			(_metrics_converter::to_signature == to);
@@ -237,6 +728,50 @@ struct converter_traits<std::tuple<_primary, _minors...>>
 };
 
 
+// Metric group.
+// tuple<primary, minors...>: every unit goes through the primary one.
+template<class...>
+struct metric_group;
+
+template<class _primary, class... _minors>
+struct metric_group<std::tuple<_primary, _minors...>>
+{
+	constexpr static std::size_t size = 1 + sizeof...(_minors);
+	constexpr static char const * primary_signature = _primary::signature;
+
+	static bool contains(std::string_view signature)
+	{
+		return signature == _primary::signature || ((signature == _minors::signature) || ...);
+	}
+
+	// Value of 'from' in the primary unit, nullopt if it is not in the group.
+	static std::optional<float> normalize(std::string_view from, float value)
+	{
+		if (from == _primary::signature)
+			return value;
+
+		const auto & factory = converter_factory::instance();
+		std::optional<float> result;
+		((from == _minors::signature ? (result = factory->converter<_primary, _minors>().forward(value), true) : false) || ...);
+		return result;
+	}
+
+	// Visit every unit of the group with the value converted to it.
+	// The conversions are independent and unrolled, so they are computed
+	// side by side.
+	template<class _visitor>
+	static void fan_out(float primary_value, _visitor && visit)
+	{
+		const auto & factory = converter_factory::instance();
+		const float results[size] = { primary_value, factory->converter<_primary, _minors>().backward(primary_value)... };
+		const char * const signatures[size] = { _primary::signature, _minors::signature... };
+
+		for (std::size_t i = 0; i < size; ++i)
+			visit(std::string_view(signatures[i]), results[i]);
+	}
+};
+
+
 // Converter.
 template<class... _metrics>
 class converter
@@ -249,13 +784,64 @@ public:
 		return m_instance;
 	}
 
-	std::optional<float> process(const std::string & from, const std::string & to, float value)
+	std::optional<float> process(std::string_view from, std::string_view to, float value)
 	{
-		if (m_responsible)
-			return m_responsible->process(from, to, value);
+		if (auto conversion = plan(from, to))
+			return conversion->convert(value);
 		return std::nullopt;
 	}
 
+	// Plan converting 'from' to 'to'. Units are resolved through the unit
+	// lexicon, so aliases and SI prefixed forms are accepted, the prefix
+	// scales are folded into the plan.
+	std::optional<conversion_plan> plan(std::string_view from, std::string_view to) const
+	{
+		auto from_unit = unit_lexicon::find(from);
+		auto to_unit = unit_lexicon::find(to);
+		if (!from_unit || !to_unit)
+			return std::nullopt;
+
+		// Same unit with other prefixes (km -> m), no actor handles it.
+		if (from_unit->signature == to_unit->signature)
+			return conversion_plan{}.scaled(from_unit->scale, to_unit->scale);
+
+		auto actor = find(from_unit->signature, to_unit->signature);
+		if (!actor)
+			return std::nullopt;
+		return actor->plan().scaled(from_unit->scale, to_unit->scale);
+	}
+
+	// Convert 'value' to every unit of the group of 'from', calling
+	// visit(signature, result) for each. Returns false if 'from' is unknown.
+	template<class _visitor>
+	bool fan_out(std::string_view from, float value, _visitor && visit) const
+	{
+		auto from_unit = unit_lexicon::find(from);
+		if (!from_unit)
+			return false;
+
+		value = static_cast<float>(value * from_unit->scale);
+		return (fan_out_group<_metrics>(from_unit->signature, value, visit) || ...);
+	}
+
+	// Signature of the primary unit of the group of 'signature', nullopt if
+	// it is in no group.
+	std::optional<std::string_view> primary(std::string_view signature) const
+	{
+		std::optional<std::string_view> result;
+		((metric_group<_metrics>::contains(signature) ?
+			(result = metric_group<_metrics>::primary_signature, true) : false) || ...);
+		return result;
+	}
+
+	// Actor responsible for a pair of signatures, nullptr if unknown.
+	const responsible * find(std::string_view from, std::string_view to) const
+	{
+		if (m_responsible)
+			return m_responsible->find(from, to);
+		return nullptr;
+	}
+
 
 protected:
 	converter()
@@ -263,6 +849,17 @@ protected:
 		add_responsible_groups<_metrics...>();
 	}
 
+	template<class _group, class _visitor>
+	static bool fan_out_group(std::string_view from, float value, _visitor & visit)
+	{
+		auto primary_value = metric_group<_group>::normalize(from, value);
+		if (!primary_value)
+			return false;
+
+		metric_group<_group>::fan_out(primary_value.value(), visit);
+		return true;
+	}
+
 	// Add group of responsible actors.
 	template<class _first, class... _rest>
 	void add_responsible_groups()
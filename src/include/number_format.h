@@ -0,0 +1,70 @@
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <optional>
+#include <string_view>
+
+
+
+// Number formatting for response fields.
+// By default a value is written with the fewest digits that read back to
+// the same float (std::to_chars, Ryu based, locale independent); with a
+// 'digits' count it is rounded to that many decimals instead. Characters
+// are written straight into the caller's buffer, nothing is allocated.
+class number_format
+{
+public:
+	// Enough for any float, fixed or shortest.
+	constexpr static std::size_t max_size = 64;
+	constexpr static int shortest = -1;
+	constexpr static int max_digits = 9;
+
+	explicit number_format(int digits = shortest) :
+		m_digits(digits)
+	{
+		;
+	}
+
+	// Format from a 'digits' request parameter, empty meaning shortest.
+	// nullopt if the parameter is not a count in [0, max_digits].
+	static std::optional<number_format> parse(std::string_view digits)
+	{
+		if (digits.empty())
+			return number_format();
+
+		int count = 0;
+		auto result = std::from_chars(digits.data(), digits.data() + digits.size(), count);
+		if (result.ec != std::errc() || result.ptr != digits.data() + digits.size() || count < 0 || count > max_digits)
+			return std::nullopt;
+		return number_format(count);
+	}
+
+	// Decimals written, shortest if none.
+	int digits() const
+	{
+		return m_digits;
+	}
+
+	// Write 'value' at 'first', returns the end of the written characters.
+	// The buffer must hold max_size characters.
+	char * write(char * first, float value) const
+	{
+		auto result = m_digits == shortest ?
+			std::to_chars(first, first + max_size, value) :
+			std::to_chars(first, first + max_size, value, std::chars_format::fixed, m_digits);
+		return result.ptr;
+	}
+
+	// Append 'value' to a string like buffer, formatting in place.
+	template<class _buffer>
+	void append(_buffer & buffer, float value) const
+	{
+		std::size_t size = buffer.size();
+		buffer.resize(size + max_size);
+		buffer.resize(static_cast<std::size_t>(write(&buffer[size], value) - &buffer[0]));
+	}
+
+private:
+	int m_digits;
+};
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+
+
+// Number parsing for request values.
+// Works on a string_view, never allocates, never throws and ignores the
+// locale. Plain decimals, the bulk of what CSV and NDJSON readings hold,
+// are parsed eight digits at a time (SWAR) and converted exactly with a
+// single multiplication or division (Clinger's fast path). Anything else,
+// such as exponents or long mantissas, goes to std::from_chars, which
+// rounds correctly (Eisel-Lemire with a big number fallback).
+class number_parser
+{
+public:
+	// Parse the whole of 'text' (a leading '+' is accepted, when followed
+	// by a digit or a point, as '-' is), false if it is not a number.
+	static bool parse(std::string_view text, float & value)
+	{
+		if (!text.empty() && text.front() == '+')
+		{
+			// No second sign ("+-3"), a point is accepted as after '-' ("+.5").
+			text.remove_prefix(1);
+			std::size_t digit = !text.empty() && text.front() == '.';
+			if (digit >= text.size() || static_cast<unsigned char>(text[digit] - '0') >= 10)
+				return false;
+		}
+		if (text.empty())
+			return false;
+
+		if (parse_decimal(text, value))
+			return true;
+
+		auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+		return result.ec == std::errc() && result.ptr == text.data() + text.size();
+	}
+
+private:
+	// Integers below 2^24 and powers of ten up to 10^10 are exact floats,
+	// so one operation between them is correctly rounded.
+	constexpr static bool little_endian = __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__;
+
+	constexpr static std::uint64_t max_exact_mantissa = 1ull << 24;
+	constexpr static int max_exact_exponent = 10;
+	constexpr static float powers_of_ten[max_exact_exponent + 1] =
+		{ 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+
+	// "[-]digits[.digits]" within the fast path range, false otherwise
+	// (the caller falls back). At most 19 digits fit in the mantissa
+	// without overflow, longer texts are left to the fallback.
+	static bool parse_decimal(std::string_view text, float & value)
+	{
+		if (text.size() > 19)
+			return false;
+
+		const char * position = text.data();
+		const char * end = position + text.size();
+
+		bool negative = *position == '-';
+		position += negative;
+
+		std::uint64_t mantissa = 0;
+		const char * integer_start = position;
+		position = parse_digits(position, end, mantissa);
+		std::size_t integers = static_cast<std::size_t>(position - integer_start);
+
+		std::size_t decimals = 0;
+		if (position != end && *position == '.')
+		{
+			const char * fraction_start = ++position;
+			position = parse_digits(position, end, mantissa);
+			decimals = static_cast<std::size_t>(position - fraction_start);
+		}
+
+		// Exponents, trailing characters, inexact values.
+		if (position != end || integers + decimals == 0 || mantissa > max_exact_mantissa || decimals > max_exact_exponent)
+			return false;
+
+		float result = static_cast<float>(mantissa);
+		if (decimals)
+			result /= powers_of_ten[decimals];
+		value = negative ? -result : result;
+		return true;
+	}
+
+	// Accumulate decimal digits, eight at a time while possible.
+	static const char * parse_digits(const char * position, const char * end, std::uint64_t & mantissa)
+	{
+		if (little_endian && end - position >= 8)
+		{
+			std::uint64_t chunk;
+			std::memcpy(&chunk, position, sizeof chunk);
+			if (all_digits(chunk))
+			{
+				mantissa = mantissa * 100'000'000 + eight_digits(chunk);
+				position += 8;
+			}
+		}
+
+		for (; position != end && static_cast<unsigned char>(*position - '0') < 10; ++position)
+			mantissa = mantissa * 10 + static_cast<std::uint64_t>(*position - '0');
+		return position;
+	}
+
+	// Little endian load of eight characters, all in '0'...'9'.
+	static bool all_digits(std::uint64_t chunk)
+	{
+		return ((chunk & 0xF0F0F0F0F0F0F0F0ull) == 0x3030303030303030ull) &&
+			(((chunk + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) == 0x3030303030303030ull);
+	}
+
+	// Value of eight digits with three multiplications (first character is
+	// the least significant byte).
+	static std::uint32_t eight_digits(std::uint64_t chunk)
+	{
+		chunk = ((chunk & 0x0F0F0F0F0F0F0F0Full) * 2561) >> 8;
+		chunk = ((chunk & 0x00FF00FF00FF00FFull) * 6553601) >> 16;
+		return static_cast<std::uint32_t>(((chunk & 0x0000FFFF0000FFFFull) * 42949672960001ull) >> 32);
+	}
+};
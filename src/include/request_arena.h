@@ -0,0 +1,73 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <memory_resource>
+#include <string>
+
+
+
+// Per-worker monotonic arena for objects that live as long as one request.
+// Allocations are a pointer bump into a thread local block, nothing is
+// freed until the request is over and the whole arena is rewound at once.
+// Using it is opt-in: a handler takes a scope, builds its temporaries with
+// resource() and must not let them escape the scope (the response body is
+// copied into the response buffer by 'send', so it may live in the arena).
+class request_arena
+{
+public:
+	constexpr static std::size_t initial_size = 16 * 1024;
+
+	request_arena(const request_arena &) = delete;
+	request_arena & operator=(const request_arena &) = delete;
+
+	// Arena of the calling worker thread.
+	static request_arena & local()
+	{
+		thread_local request_arena arena;
+		return arena;
+	}
+
+	std::pmr::memory_resource * resource()
+	{
+		return &m_resource;
+	}
+
+	// Rewind the arena, keeping the initial block for the next request.
+	void reset()
+	{
+		m_resource.release();
+	}
+
+	// Resets the worker arena when the request handling is over.
+	class scope
+	{
+	public:
+		scope() : m_arena(request_arena::local()) { ; }
+		~scope() { m_arena.reset(); }
+
+		scope(const scope &) = delete;
+		scope & operator=(const scope &) = delete;
+
+		std::pmr::memory_resource * resource() const
+		{
+			return m_arena.resource();
+		}
+
+	private:
+		request_arena & m_arena;
+	};
+
+private:
+	// Requests bigger than the initial block spill over to the global
+	// allocator, the extra blocks are given back on reset.
+	request_arena() :
+		m_buffer(),
+		m_resource(m_buffer.data(), m_buffer.size(), std::pmr::new_delete_resource())
+	{
+		;
+	}
+
+	alignas(std::max_align_t) std::array<std::byte, initial_size> m_buffer;
+	std::pmr::monotonic_buffer_resource m_resource;
+};
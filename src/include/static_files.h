@@ -0,0 +1,410 @@
+#pragma once
+
+#include <algorithm>
+#include <limits>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <optional>
+#include <ctime>
+
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "pistache/http.h"
+
+
+
+// Static files served from one directory.
+// Open descriptors and their stat metadata are kept in a LRU cache, so a hot
+// asset costs neither an open() nor a stat() per request. Entries are
+// invalidated through inotify when the file changes on disk. Validators
+// (ETag, Last-Modified) are derived from the cached metadata, so conditional
+// requests are answered without touching the disk.
+class static_files
+{
+public:
+	constexpr static std::size_t default_capacity = 256;
+	// Largest range sent as a partial response. Ranges are read into memory,
+	// so bigger ones are ignored and the whole file goes through sendfile
+	// (RFC 7233 allows a server to ignore Range).
+	constexpr static std::size_t max_range_size = 1024 * 1024;
+
+	explicit static_files(std::string root, std::size_t capacity = default_capacity) :
+		m_root(std::move(root)),
+		m_capacity(capacity),
+		m_notify_fd(inotify_init1(IN_NONBLOCK | IN_CLOEXEC))
+	{
+		while (m_root.size() > 1 && m_root.back() == '/')
+			m_root.pop_back();
+	}
+
+	~static_files()
+	{
+		if (m_notify_fd != -1)
+			close(m_notify_fd);
+	}
+
+	static_files(const static_files &) = delete;
+	static_files & operator=(const static_files &) = delete;
+
+	// Serve 'path' (relative to the root directory) to the client.
+	void serve(const Pistache::Http::Request & request, std::string_view path, Pistache::Http::ResponseWriter & response)
+	{
+		using namespace Pistache::Http;
+
+		auto file = find(path);
+		if (!file)
+		{
+			response.send(Code::Not_Found, "File not found!");
+			return;
+		}
+
+		response.headers()
+			.addRaw(Header::Raw("ETag", file->etag))
+			.addRaw(Header::Raw("Last-Modified", file->last_modified))
+			.addRaw(Header::Raw("Accept-Ranges", "bytes"));
+
+		auto if_none_match = request.headers().tryGetRaw("If-None-Match");
+		if (!if_none_match.isEmpty())
+		{
+			if (matches(if_none_match.get().value(), file->etag))
+			{
+				response.send(Code::Not_Modified);
+				return;
+			}
+		}
+
+		auto range_header = request.headers().tryGetRaw("Range");
+		if (!range_header.isEmpty())
+		{
+			auto range = parse_range(range_header.get().value(), file->size);
+			if (range && range->first > range->second)
+			{
+				response.headers().addRaw(Header::Raw("Content-Range", "bytes */" + std::to_string(file->size)));
+				response.send(Code::Requested_Range_Not_Satisfiable);
+				return;
+			}
+			if (range && range->second - range->first < max_range_size)
+			{
+				serve_range(*file, range->first, range->second, response);
+				return;
+			}
+		}
+
+		// Keep the descriptor alive until the transport is done with it,
+		// even if the entry is evicted or invalidated in the meantime.
+		serveFile(response, Pistache::FileBuffer(file->path, file->fd, file->size), file->mime)
+			.then([file](ssize_t) { ; }, [file](std::exception_ptr) { ; });
+	}
+
+private:
+	// Open file with its metadata.
+	struct open_file
+	{
+		open_file(const open_file &) = delete;
+		open_file & operator=(const open_file &) = delete;
+
+		open_file(std::string path_, int fd_, const struct stat & st) :
+			path(std::move(path_)),
+			fd(fd_),
+			size(static_cast<std::size_t>(st.st_size)),
+			mime(Pistache::Http::Mime::MediaType::fromFile(path.c_str()))
+		{
+			char buffer[64];
+			snprintf(buffer, sizeof buffer, "\"%zx-%llx\"", size,
+				static_cast<unsigned long long>(st.st_mtim.tv_sec) * 1'000'000'000ull + st.st_mtim.tv_nsec);
+			etag = buffer;
+
+			struct tm tm;
+			gmtime_r(&st.st_mtim.tv_sec, &tm);
+			strftime(buffer, sizeof buffer, "%a, %d %b %Y %H:%M:%S GMT", &tm);
+			last_modified = buffer;
+		}
+
+		~open_file()
+		{
+			close(fd);
+		}
+
+		std::string path;
+		int fd;
+		std::size_t size;
+		std::string etag;
+		std::string last_modified;
+		Pistache::Http::Mime::MediaType mime;
+	};
+
+	using entry_list = std::list<std::pair<std::string, std::shared_ptr<open_file>>>;
+
+	std::shared_ptr<open_file> find(std::string_view path)
+	{
+		if (!is_safe(path))
+			return nullptr;
+
+		std::string full_path = m_root + "/" + std::string(path);
+
+		std::lock_guard<std::mutex> guard(m_lock);
+		drain_notifications();
+
+		auto it = m_index.find(full_path);
+		if (it != m_index.end())
+		{
+			m_entries.splice(m_entries.begin(), m_entries, it->second);
+			return it->second->second;
+		}
+
+		int fd = open(full_path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd == -1)
+			return nullptr;
+
+		struct stat st;
+		if (fstat(fd, &st) == -1 || !S_ISREG(st.st_mode))
+		{
+			close(fd);
+			return nullptr;
+		}
+
+		// Without a watch on its directory the entry could go stale, so it
+		// is served but not cached.
+		auto file = std::make_shared<open_file>(full_path, fd, st);
+		if (!watch(full_path.substr(0, full_path.rfind('/'))))
+			return file;
+
+		m_entries.emplace_front(full_path, file);
+		m_index[full_path] = m_entries.begin();
+		if (m_entries.size() > m_capacity)
+		{
+			m_index.erase(m_entries.back().first);
+			m_entries.pop_back();
+		}
+
+		return file;
+	}
+
+	bool watch(const std::string & directory)
+	{
+		if (m_notify_fd == -1)
+			return false;
+
+		int wd = inotify_add_watch(m_notify_fd, directory.c_str(),
+			IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE | IN_DELETE_SELF | IN_MOVE_SELF);
+		if (wd == -1)
+			return false;
+
+		m_watches[wd] = directory;
+		return true;
+	}
+
+	// Drop the entries of every file changed since the last call.
+	void drain_notifications()
+	{
+		if (m_notify_fd == -1)
+			return;
+
+		alignas(struct inotify_event) char buffer[4096];
+		for (;;)
+		{
+			ssize_t bytes = read(m_notify_fd, buffer, sizeof buffer);
+			if (bytes <= 0)
+				break;
+
+			for (char * ptr = buffer; ptr < buffer + bytes;)
+			{
+				auto * event = reinterpret_cast<struct inotify_event *>(ptr);
+				ptr += sizeof(struct inotify_event) + event->len;
+
+				// Events were lost (the overflow carries no watch), any
+				// entry may be stale.
+				if (event->mask & IN_Q_OVERFLOW)
+				{
+					m_entries.clear();
+					m_index.clear();
+					continue;
+				}
+
+				auto watched = m_watches.find(event->wd);
+				if (watched == m_watches.end())
+					continue;
+
+				if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED))
+				{
+					invalidate_directory(watched->second);
+					if (event->mask & IN_IGNORED)
+						m_watches.erase(watched);
+				}
+				else if (event->len != 0)
+					invalidate(watched->second + "/" + event->name);
+			}
+		}
+	}
+
+	void invalidate(const std::string & full_path)
+	{
+		auto it = m_index.find(full_path);
+		if (it == m_index.end())
+			return;
+
+		m_entries.erase(it->second);
+		m_index.erase(it);
+	}
+
+	void invalidate_directory(const std::string & directory)
+	{
+		for (auto it = m_entries.begin(); it != m_entries.end();)
+		{
+			if (it->first.compare(0, directory.size() + 1, directory + "/") == 0)
+			{
+				m_index.erase(it->first);
+				it = m_entries.erase(it);
+			}
+			else
+				++it;
+		}
+	}
+
+	// Send bytes [first, last] of the file as a partial response.
+	static void serve_range(const open_file & file, std::size_t first, std::size_t last, Pistache::Http::ResponseWriter & response)
+	{
+		using namespace Pistache::Http;
+
+		std::string body(last - first + 1, '\0');
+		std::size_t done = 0;
+		while (done < body.size())
+		{
+			ssize_t bytes = pread(file.fd, &body[done], body.size() - done, static_cast<off_t>(first + done));
+			if (bytes <= 0)
+			{
+				response.send(Code::Internal_Server_Error, "Read error!");
+				return;
+			}
+			done += static_cast<std::size_t>(bytes);
+		}
+
+		response.headers().addRaw(Header::Raw("Content-Range",
+			"bytes " + std::to_string(first) + "-" + std::to_string(last) + "/" + std::to_string(file.size)));
+		response.send(Code::Partial_Content, body, file.mime);
+	}
+
+	// Parse a single "bytes=first-last" range. Returns nullopt when the header
+	// must be ignored (the full content is sent) and first > last when it is
+	// not satisfiable.
+	static std::optional<std::pair<std::size_t, std::size_t>> parse_range(std::string_view value, std::size_t size)
+	{
+		constexpr std::string_view unit = "bytes=";
+		constexpr std::pair<std::size_t, std::size_t> unsatisfiable{ 1, 0 };
+
+		if (value.substr(0, unit.size()) != unit || value.find(',') != std::string_view::npos)
+			return std::nullopt;
+		value.remove_prefix(unit.size());
+
+		auto dash = value.find('-');
+		if (dash == std::string_view::npos)
+			return std::nullopt;
+
+		auto first_part = value.substr(0, dash);
+		auto last_part = value.substr(dash + 1);
+		std::size_t first = 0, last = 0;
+
+		if (first_part.empty())
+		{
+			// Suffix range: the last N bytes.
+			if (!parse_number(last_part, last))
+				return std::nullopt;
+			if (last == 0 || size == 0)
+				return unsatisfiable;
+			first = last >= size ? 0 : size - last;
+			return std::make_pair(first, size - 1);
+		}
+
+		if (!parse_number(first_part, first))
+			return std::nullopt;
+		if (last_part.empty())
+			last = size - 1;
+		else if (!parse_number(last_part, last) || last < first)
+			return std::nullopt;
+
+		if (first >= size)
+			return unsatisfiable;
+		return std::make_pair(first, std::min(last, size - 1));
+	}
+
+	// Fails on anything but digits and on values that do not fit.
+	static bool parse_number(std::string_view text, std::size_t & number)
+	{
+		if (text.empty())
+			return false;
+
+		number = 0;
+		for (char c : text)
+		{
+			if (c < '0' || c > '9')
+				return false;
+			auto digit = static_cast<std::size_t>(c - '0');
+			if (number > (std::numeric_limits<std::size_t>::max() - digit) / 10)
+				return false;
+			number = number * 10 + digit;
+		}
+		return true;
+	}
+
+	static bool matches(std::string_view if_none_match, std::string_view etag)
+	{
+		if (if_none_match == "*")
+			return true;
+
+		// Weak comparison, as required for If-None-Match.
+		while (!if_none_match.empty())
+		{
+			auto comma = if_none_match.find(',');
+			auto tag = if_none_match.substr(0, comma);
+			while (!tag.empty() && tag.front() == ' ')
+				tag.remove_prefix(1);
+			while (!tag.empty() && tag.back() == ' ')
+				tag.remove_suffix(1);
+			if (tag.substr(0, 2) == "W/")
+				tag.remove_prefix(2);
+			if (tag == etag)
+				return true;
+
+			if (comma == std::string_view::npos)
+				break;
+			if_none_match.remove_prefix(comma + 1);
+		}
+		return false;
+	}
+
+	// Reject anything that could escape the root directory.
+	static bool is_safe(std::string_view path)
+	{
+		if (path.empty() || path.front() == '/' || path.find('\0') != std::string_view::npos)
+			return false;
+
+		while (!path.empty())
+		{
+			auto slash = path.find('/');
+			auto segment = path.substr(0, slash);
+			if (segment == ".." || segment == ".")
+				return false;
+			if (slash == std::string_view::npos)
+				break;
+			path.remove_prefix(slash + 1);
+		}
+		return true;
+	}
+
+	std::string m_root;
+	std::size_t m_capacity;
+	int m_notify_fd;
+
+	std::mutex m_lock;
+	entry_list m_entries;
+	std::unordered_map<std::string, entry_list::iterator> m_index;
+	std::unordered_map<int, std::string> m_watches;
+};
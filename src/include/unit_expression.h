@@ -0,0 +1,421 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <ratio>
+#include <string>
+#include <string_view>
+
+#include "converter.h"
+#include "unit_lexicon.h"
+
+
+
+// Dimension of a unit: exponents of mass, length, time and temperature.
+using dimension = std::array<int, 4>;
+
+// Factor as an exact fraction, from a std::ratio.
+struct exact_factor
+{
+	std::int64_t numerator;
+	std::int64_t denominator;
+
+	template<class _ratio>
+	constexpr static exact_factor of()
+	{
+		return { _ratio::num, _ratio::den };
+	}
+
+	constexpr double value() const
+	{
+		return static_cast<double>(numerator) / static_cast<double>(denominator);
+	}
+};
+
+// Units known by their dimension.
+// The units of the converter standing for a base dimension, and the units
+// unknown to the converter with their exact factor over the base units
+// (g, m, s and c), so that both engines can use them.
+struct unit_dimensions
+{
+	enum { mass, length, duration, temperature };
+
+	struct derived_unit
+	{
+		std::string_view signature;
+		dimension dims;
+		exact_factor factor;
+	};
+
+	struct base_unit
+	{
+		std::string_view signature;
+		int dimension_index;
+	};
+
+	constexpr static derived_unit derived_units[] =
+	{
+		{ "s", { 0, 0, 1, 0 }, exact_factor::of<std::ratio<1>>() },
+		{ "min", { 0, 0, 1, 0 }, exact_factor::of<std::ratio<60>>() },
+		{ "h", { 0, 0, 1, 0 }, exact_factor::of<std::ratio<3'600>>() },
+		{ "d", { 0, 0, 1, 0 }, exact_factor::of<std::ratio<86'400>>() },
+		{ "ft", { 0, 1, 0, 0 }, exact_factor::of<std::ratio<3'048, 10'000>>() },
+		{ "in", { 0, 1, 0, 0 }, exact_factor::of<std::ratio<254, 10'000>>() },
+		{ "yd", { 0, 1, 0, 0 }, exact_factor::of<std::ratio<9'144, 10'000>>() },
+		// 0.45359237 kg * 9.80665 m/s^2, in g m/s^2.
+		{ "lbf", { 1, 1, -2, 0 }, exact_factor::of<std::ratio<44'482'216'152'605, 10'000'000'000>>() },
+		{ "N", { 1, 1, -2, 0 }, exact_factor::of<std::ratio<1'000>>() },
+		{ "J", { 1, 2, -2, 0 }, exact_factor::of<std::ratio<1'000>>() },
+		{ "W", { 1, 2, -3, 0 }, exact_factor::of<std::ratio<1'000>>() },
+		{ "Pa", { 1, -1, -2, 0 }, exact_factor::of<std::ratio<1'000>>() },
+		{ "Hz", { 0, 0, -1, 0 }, exact_factor::of<std::ratio<1>>() },
+		{ "L", { 0, 3, 0, 0 }, exact_factor::of<std::ratio<1, 1'000>>() },
+	};
+
+	constexpr static base_unit base_units[] = { { "g", mass }, { "m", length }, { "c", temperature } };
+
+	static const derived_unit * find_derived(std::string_view signature)
+	{
+		for (const auto & derived : derived_units)
+		{
+			if (derived.signature == signature)
+				return &derived;
+		}
+		return nullptr;
+	}
+};
+
+// Unit expressions.
+// Products and quotients of units with integer powers, such as "km/h",
+// "g/cm^3" or "lbf*ft". Each side is reduced to a factor over the base units
+// (g, m, s and c) and a dimension; when the dimensions match, the
+// conversion is the ratio of the factors. A single unit on each side still
+// goes through the converter first, which knows about offsets and
+// non-linear units; inside expressions temperatures are intervals and
+// non-linear units are refused.
+// Compiled plans are memoized per worker thread.
+template<class _converter>
+class unit_expression
+{
+public:
+	// Longest expression accepted, so that a cache slot never holds more.
+	constexpr static std::size_t max_expression = 64;
+	// Most targets converted at once by convert_each().
+	constexpr static std::size_t max_targets = 64;
+
+	// Plan converting expression 'from' to expression 'to', nullopt if an
+	// unit is unknown, the dimensions differ or an expression is longer
+	// than max_expression.
+	static std::optional<conversion_plan> plan(std::string_view from, std::string_view to)
+	{
+		if (from.size() > max_expression || to.size() > max_expression)
+			return std::nullopt;
+
+		thread_local plan_cache cache;
+		return cache.find(from, to);
+	}
+
+	// Convert 'value' to every unit of the dimension of the single unit
+	// 'from': the units of its converter group and the derived units,
+	// calling visit(signature, result) for each. Units whose domain does
+	// not hold the value (awg of 0 m, typek of 2000 c) are skipped, none
+	// is visited when 'value' is outside the domain of 'from'. Returns
+	// false if 'from' is unknown.
+	template<class _visitor>
+	static bool fan_out(std::string_view from, float value, _visitor && outer_visit)
+	{
+		auto visit = [&outer_visit](std::string_view signature, float result)
+		{
+			if (std::isfinite(result))
+				outer_visit(signature, result);
+		};
+
+		const auto & instance = _converter::instance();
+		bool known = instance->fan_out(from, value, visit);
+
+		auto from_side = single_unit(from);
+		if (!from_side)
+			return known;
+
+		// A derived unit of a base dimension (ft) lists the group of the
+		// base unit (m) too.
+		float base_value = from_side->to_base.convert(value);
+		for (const auto & base : unit_dimensions::base_units)
+		{
+			dimension base_dims{};
+			base_dims[base.dimension_index] = 1;
+			if (!known && base_dims == from_side->dims)
+				known = instance->fan_out(base.signature, base_value, visit);
+		}
+
+		for (const auto & derived : unit_dimensions::derived_units)
+		{
+			if (derived.dims != from_side->dims)
+				continue;
+
+			visit(derived.signature, static_cast<float>(base_value / derived.factor.value()));
+			known = true;
+		}
+		return known;
+	}
+
+	// Convert 'value' to each unit or expression of the comma separated
+	// 'targets', calling visit(target, result) in order. 'from' is
+	// normalized once, to the base unit of its dimension or to the primary
+	// unit of its group, and each target applies its plan from there.
+	// Repeated targets are visited once. Returns false, possibly after
+	// visiting some targets, if a unit is unknown or of another dimension,
+	// or if there are more than max_targets targets or longer than
+	// max_expression.
+	template<class _visitor>
+	static bool convert_each(std::string_view from, float value, std::string_view targets, _visitor && visit)
+	{
+		if (from.size() > max_expression)
+			return false;
+
+		auto each = [&targets](auto && convert)
+		{
+			std::size_t count = 0;
+			for (std::string_view rest = targets; !rest.empty();)
+			{
+				auto comma = rest.find(',');
+				auto target = rest.substr(0, comma);
+				if (++count > max_targets || target.size() > max_expression)
+					return false;
+				if (!repeated(targets, static_cast<std::size_t>(rest.data() - targets.data()), target) && !convert(target))
+					return false;
+				rest.remove_prefix(comma == std::string_view::npos ? rest.size() : comma + 1);
+			}
+			return true;
+		};
+
+		if (auto from_side = reduce_side(from))
+		{
+			float base_value = from_side->to_base.convert(value);
+			return each([&](std::string_view target)
+			{
+				auto to_side = reduce_side(target);
+				if (!to_side || to_side->dims != from_side->dims)
+					return false;
+				visit(target, to_side->from_base.convert(base_value));
+				return true;
+			});
+		}
+
+		// Units without a dimension (dB, pH) go through their group.
+		const auto & instance = _converter::instance();
+		auto from_name = unit_lexicon::find(from);
+		auto primary = from_name ? instance->primary(from_name->signature) : std::nullopt;
+		auto to_primary = primary ? instance->plan(from, *primary) : std::nullopt;
+		if (!to_primary)
+			return false;
+
+		float primary_value = to_primary->convert(value);
+		return each([&](std::string_view target)
+		{
+			auto from_primary = instance->plan(*primary, target);
+			if (!from_primary)
+				return false;
+			visit(target, from_primary->convert(primary_value));
+			return true;
+		});
+	}
+
+private:
+	// Unit reduced to the base units.
+	struct term
+	{
+		dimension dims;
+		double factor;
+	};
+
+	// Side of a conversion, with its plans to and from the base units.
+	struct side
+	{
+		dimension dims;
+		conversion_plan to_base;
+		conversion_plan from_base;
+	};
+
+	// Direct mapped cache: a lookup is one hash and one comparison, without
+	// locks (it is per thread) nor allocations once the slot strings have
+	// grown, to max_expression at most. Failed compilations are cached too.
+	class plan_cache
+	{
+	public:
+		constexpr static std::size_t size = 256;
+
+		std::optional<conversion_plan> find(std::string_view from, std::string_view to)
+		{
+			std::size_t key = std::hash<std::string_view>()(from);
+			key ^= std::hash<std::string_view>()(to) + 0x9E3779B97F4A7C15ull + (key << 6) + (key >> 2);
+
+			auto & slot = m_slots[key & (size - 1)];
+			if (slot.used && slot.key == key && slot.from == from && slot.to == to)
+				return slot.plan;
+
+			slot.used = true;
+			slot.key = key;
+			slot.from.assign(from.data(), from.size());
+			slot.to.assign(to.data(), to.size());
+			slot.plan = compile(from, to);
+			return slot.plan;
+		}
+
+	private:
+		struct entry
+		{
+			bool used = false;
+			std::size_t key = 0;
+			std::string from;
+			std::string to;
+			std::optional<conversion_plan> plan;
+		};
+
+		std::array<entry, size> m_slots;
+	};
+
+	static std::optional<conversion_plan> compile(std::string_view from, std::string_view to)
+	{
+		if (auto simple = _converter::instance()->plan(from, to))
+			return simple;
+
+		auto from_side = reduce_side(from);
+		auto to_side = reduce_side(to);
+		if (!from_side || !to_side || from_side->dims != to_side->dims)
+			return std::nullopt;
+
+		return from_side->to_base.then(to_side->from_base);
+	}
+
+	// A single unit keeps its full plans (offsets, curves), an expression
+	// is a factor.
+	static std::optional<side> reduce_side(std::string_view expression)
+	{
+		if (expression.find_first_of("*/^") == std::string_view::npos)
+			return single_unit(expression);
+
+		auto reduced = reduce(expression);
+		if (!reduced)
+			return std::nullopt;
+
+		return side{ reduced->dims,
+			conversion_plan{ static_cast<float>(reduced->factor), 0.f },
+			conversion_plan{ static_cast<float>(1. / reduced->factor), 0.f } };
+	}
+
+	// Reduce "a*b/c^2" to its factor and dimension. A '/' divides by the
+	// next unit only.
+	static std::optional<term> reduce(std::string_view expression)
+	{
+		term result{ {}, 1. };
+		int sign = 1;
+
+		for (;;)
+		{
+			auto end = expression.find_first_of("*/");
+			auto name = expression.substr(0, end);
+
+			int power = 1;
+			auto caret = name.find('^');
+			if (caret != std::string_view::npos)
+			{
+				if (!parse_power(name.substr(caret + 1), power))
+					return std::nullopt;
+				name = name.substr(0, caret);
+			}
+
+			auto unit = find_unit(name);
+			if (!unit)
+				return std::nullopt;
+
+			power *= sign;
+			for (std::size_t i = 0; i < result.dims.size(); ++i)
+				result.dims[i] += unit->dims[i] * power;
+			for (int i = 0; i < (power < 0 ? -power : power); ++i)
+				result.factor = power < 0 ? result.factor / unit->factor : result.factor * unit->factor;
+
+			if (end == std::string_view::npos)
+				return result;
+
+			sign = expression[end] == '/' ? -1 : 1;
+			expression.remove_prefix(end + 1);
+		}
+	}
+
+	// Unit inside a product: only its factor counts, offsets are dropped.
+	static std::optional<term> find_unit(std::string_view name)
+	{
+		auto unit = single_unit(name);
+		if (!unit || !unit->to_base.is_linear())
+			return std::nullopt;
+
+		return term{ unit->dims, unit->to_base.factor };
+	}
+
+	static std::optional<side> single_unit(std::string_view name)
+	{
+		auto unit = unit_lexicon::find(name);
+		if (!unit)
+			return std::nullopt;
+
+		if (const auto * derived = unit_dimensions::find_derived(unit->signature))
+		{
+			double factor = derived->factor.value() * unit->scale;
+			return side{ derived->dims,
+				conversion_plan{ static_cast<float>(factor), 0.f },
+				conversion_plan{ static_cast<float>(1. / factor), 0.f } };
+		}
+
+		// Converter units go through the base unit of their group.
+		const auto & instance = _converter::instance();
+		for (const auto & base : unit_dimensions::base_units)
+		{
+			auto to_base = instance->plan(name, base.signature);
+			auto from_base = instance->plan(base.signature, name);
+			if (to_base && from_base)
+			{
+				side result{ {}, *to_base, *from_base };
+				result.dims[base.dimension_index] = 1;
+				return result;
+			}
+		}
+		return std::nullopt;
+	}
+
+	// Whether 'target', found at 'position' in 'targets', appears before.
+	static bool repeated(std::string_view targets, std::size_t position, std::string_view target)
+	{
+		for (std::string_view before = targets.substr(0, position); !before.empty();)
+		{
+			auto comma = before.find(',');
+			if (before.substr(0, comma) == target)
+				return true;
+			before.remove_prefix(comma == std::string_view::npos ? before.size() : comma + 1);
+		}
+		return false;
+	}
+
+	static bool parse_power(std::string_view text, int & power)
+	{
+		bool negative = !text.empty() && text.front() == '-';
+		if (negative)
+			text.remove_prefix(1);
+		if (text.empty() || text.size() > 2)
+			return false;
+
+		power = 0;
+		for (char c : text)
+		{
+			if (c < '0' || c > '9')
+				return false;
+			power = power * 10 + (c - '0');
+		}
+		power = negative ? -power : power;
+		return true;
+	}
+};
@@ -0,0 +1,289 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+
+
+// Unit name resolved by the lexicon: the signature of the unit known to the
+// converter or to unit expressions, and the scale of the name relative to it
+// (1000 for "km").
+struct unit_name
+{
+	std::string_view signature;
+	double scale;
+};
+
+// Spellings accepted for the units of the converter.
+struct unit_lexicon_source
+{
+	// Which prefixes a name takes: none, symbols ("km") or names ("kilometer").
+	enum class prefixes { none, symbols, names };
+
+	struct base_name
+	{
+		std::string_view name;
+		std::string_view signature;
+		prefixes prefixed;
+	};
+
+	struct si_prefix
+	{
+		std::string_view text;
+		double scale;
+	};
+
+	constexpr static base_name names[] =
+	{
+		// Weight.
+		{ "g", "g", prefixes::symbols }, { "gram", "g", prefixes::names }, { "grams", "g", prefixes::names },
+		{ "gramm", "g", prefixes::names }, { "gramme", "g", prefixes::names }, { "grammes", "g", prefixes::names },
+		{ "lb", "lb", prefixes::none }, { "lbs", "lb", prefixes::none }, { "pound", "lb", prefixes::none }, { "pounds", "lb", prefixes::none },
+		{ "p", "p", prefixes::none }, { "pood", "p", prefixes::none }, { "poods", "p", prefixes::none },
+		// Distance.
+		{ "m", "m", prefixes::symbols }, { "meter", "m", prefixes::names }, { "meters", "m", prefixes::names },
+		{ "metre", "m", prefixes::names }, { "metres", "m", prefixes::names },
+		{ "ml", "ml", prefixes::none }, { "mi", "ml", prefixes::none }, { "mile", "ml", prefixes::none }, { "miles", "ml", prefixes::none },
+		{ "v", "v", prefixes::none }, { "verst", "v", prefixes::none }, { "versts", "v", prefixes::none },
+		{ "awg", "awg", prefixes::none }, { "AWG", "awg", prefixes::none }, { "gauge", "awg", prefixes::none },
+		{ "ft", "ft", prefixes::none }, { "foot", "ft", prefixes::none }, { "feet", "ft", prefixes::none },
+		{ "in", "in", prefixes::none }, { "inch", "in", prefixes::none }, { "inches", "in", prefixes::none },
+		{ "yd", "yd", prefixes::none }, { "yard", "yd", prefixes::none }, { "yards", "yd", prefixes::none },
+		// Temperature, the offsets make prefixes meaningless.
+		{ "c", "c", prefixes::none }, { "C", "c", prefixes::none }, { "celsius", "c", prefixes::none },
+		{ "f", "f", prefixes::none }, { "F", "f", prefixes::none }, { "fahrenheit", "f", prefixes::none },
+		{ "k", "k", prefixes::none }, { "K", "k", prefixes::none }, { "kelvin", "k", prefixes::none },
+		{ "typek", "typek", prefixes::none },
+		// Power ratio and acidity.
+		{ "ratio", "ratio", prefixes::none }, { "dB", "dB", prefixes::none }, { "decibel", "dB", prefixes::none },
+		{ "decibels", "dB", prefixes::none }, { "pH", "pH", prefixes::none }, { "cH", "cH", prefixes::none },
+		// Time.
+		{ "s", "s", prefixes::symbols }, { "second", "s", prefixes::names }, { "seconds", "s", prefixes::names },
+		{ "min", "min", prefixes::none }, { "minute", "min", prefixes::none }, { "minutes", "min", prefixes::none },
+		{ "h", "h", prefixes::none }, { "hour", "h", prefixes::none }, { "hours", "h", prefixes::none },
+		{ "d", "d", prefixes::none }, { "day", "d", prefixes::none }, { "days", "d", prefixes::none },
+		// Derived units, only used in unit expressions.
+		{ "lbf", "lbf", prefixes::none }, { "pound-force", "lbf", prefixes::none },
+		{ "N", "N", prefixes::symbols }, { "newton", "N", prefixes::names }, { "newtons", "N", prefixes::names },
+		{ "J", "J", prefixes::symbols }, { "joule", "J", prefixes::names }, { "joules", "J", prefixes::names },
+		{ "W", "W", prefixes::symbols }, { "watt", "W", prefixes::names }, { "watts", "W", prefixes::names },
+		{ "Pa", "Pa", prefixes::symbols }, { "pascal", "Pa", prefixes::names }, { "pascals", "Pa", prefixes::names },
+		{ "Hz", "Hz", prefixes::symbols }, { "hertz", "Hz", prefixes::names },
+		// Lower case "l" would clash with the "ml" (mile) signature.
+		{ "L", "L", prefixes::symbols }, { "liter", "L", prefixes::names }, { "liters", "L", prefixes::names },
+		{ "litre", "L", prefixes::names }, { "litres", "L", prefixes::names },
+	};
+
+	constexpr static si_prefix symbols[] =
+	{
+		{ "Y", 1e24 }, { "Z", 1e21 }, { "E", 1e18 }, { "P", 1e15 }, { "T", 1e12 }, { "G", 1e9 }, { "M", 1e6 },
+		{ "k", 1e3 }, { "h", 1e2 }, { "da", 1e1 }, { "d", 1e-1 }, { "c", 1e-2 }, { "m", 1e-3 },
+		{ "\xC2\xB5", 1e-6 }, { "\xCE\xBC", 1e-6 }, { "u", 1e-6 },
+		{ "n", 1e-9 }, { "p", 1e-12 }, { "f", 1e-15 }, { "a", 1e-18 }, { "z", 1e-21 }, { "y", 1e-24 },
+	};
+
+	constexpr static si_prefix prefix_names[] =
+	{
+		{ "yotta", 1e24 }, { "zetta", 1e21 }, { "exa", 1e18 }, { "peta", 1e15 }, { "tera", 1e12 }, { "giga", 1e9 },
+		{ "mega", 1e6 }, { "kilo", 1e3 }, { "hecto", 1e2 }, { "deca", 1e1 }, { "deci", 1e-1 }, { "centi", 1e-2 },
+		{ "milli", 1e-3 }, { "micro", 1e-6 }, { "nano", 1e-9 }, { "pico", 1e-12 }, { "femto", 1e-15 },
+		{ "atto", 1e-18 }, { "zepto", 1e-21 }, { "yocto", 1e-24 },
+	};
+
+	constexpr static std::size_t count_entries()
+	{
+		std::size_t count = 0;
+		for (const auto & name : names)
+		{
+			++count;
+			if (name.prefixed == prefixes::symbols)
+				count += std::size(symbols);
+			else if (name.prefixed == prefixes::names)
+				count += std::size(prefix_names);
+		}
+		return count;
+	}
+};
+
+// Perfect hash table of every spelling (hash and displace), built at
+// compile time.
+struct unit_lexicon_table
+{
+	// One accepted spelling: prefix + name.
+	struct entry
+	{
+		std::string_view prefix;
+		std::string_view name;
+		std::string_view signature;
+		double scale;
+		bool used;
+
+		constexpr bool matches(std::string_view text) const
+		{
+			return text.size() == prefix.size() + name.size() &&
+				text.substr(0, prefix.size()) == prefix &&
+				text.substr(prefix.size()) == name;
+		}
+	};
+
+	constexpr static std::size_t entry_count = unit_lexicon_source::count_entries();
+	constexpr static std::size_t table_size = 2048;
+	constexpr static std::size_t max_bucket_size = 16;
+	constexpr static std::size_t bucket_count = entry_count / 2;
+
+	static_assert((table_size & (table_size - 1)) == 0, "Table size must be a power of two");
+	static_assert(table_size >= entry_count * 3 / 2, "Table is too small for the lexicon");
+
+	// FNV-1a over prefix + name, seeded, with a final avalanche so that
+	// the low bits used as index depend on every byte.
+	constexpr static std::uint32_t hash(std::string_view prefix, std::string_view name, std::uint32_t seed)
+	{
+		std::uint32_t value = 2166136261u ^ (seed * 0x9E3779B9u);
+		for (char c : prefix)
+			value = (value ^ static_cast<unsigned char>(c)) * 16777619u;
+		for (char c : name)
+			value = (value ^ static_cast<unsigned char>(c)) * 16777619u;
+
+		value ^= value >> 15;
+		value *= 0x2C1B3C6Du;
+		value ^= value >> 12;
+		return value;
+	}
+
+	struct table
+	{
+		std::array<entry, table_size> slots{};
+		std::array<std::uint32_t, bucket_count> displacements{};
+
+		constexpr std::size_t slot_of(std::string_view name) const
+		{
+			auto bucket = hash("", name, 0) % bucket_count;
+			return hash("", name, displacements[bucket]) & (table_size - 1);
+		}
+	};
+
+	constexpr static std::array<entry, entry_count> expand()
+	{
+		std::array<entry, entry_count> entries{};
+		std::size_t index = 0;
+		for (const auto & name : unit_lexicon_source::names)
+		{
+			entries[index++] = { "", name.name, name.signature, 1., true };
+			if (name.prefixed == unit_lexicon_source::prefixes::symbols)
+			{
+				for (const auto & prefix : unit_lexicon_source::symbols)
+					entries[index++] = { prefix.text, name.name, name.signature, prefix.scale, true };
+			}
+			else if (name.prefixed == unit_lexicon_source::prefixes::names)
+			{
+				for (const auto & prefix : unit_lexicon_source::prefix_names)
+					entries[index++] = { prefix.text, name.name, name.signature, prefix.scale, true };
+			}
+		}
+		return entries;
+	}
+
+	// Place the buckets, biggest first, each with the first displacement
+	// sending all of its entries to free slots.
+	constexpr static table build()
+	{
+		const auto entries = expand();
+		table result{};
+
+		std::array<std::array<std::size_t, max_bucket_size>, bucket_count> members{};
+		std::array<std::size_t, bucket_count> sizes{};
+		std::size_t largest = 0;
+		for (std::size_t i = 0; i < entry_count; ++i)
+		{
+			auto bucket = hash(entries[i].prefix, entries[i].name, 0) % bucket_count;
+			if (sizes[bucket] == max_bucket_size)
+				throw "Lexicon buckets are too unbalanced!";
+
+			members[bucket][sizes[bucket]++] = i;
+			largest = sizes[bucket] > largest ? sizes[bucket] : largest;
+		}
+
+		for (std::size_t size = largest; size > 0; --size)
+		{
+			for (std::size_t bucket = 0; bucket < bucket_count; ++bucket)
+			{
+				if (sizes[bucket] != size)
+					continue;
+
+				std::array<std::size_t, max_bucket_size> placed{};
+				for (std::uint32_t displacement = 1;; ++displacement)
+				{
+					if (displacement > 100'000)
+						throw "Lexicon has duplicated names!";
+
+					bool fits = true;
+					for (std::size_t i = 0; i < size && fits; ++i)
+					{
+						const auto & current = entries[members[bucket][i]];
+						placed[i] = hash(current.prefix, current.name, displacement) & (table_size - 1);
+						fits = !result.slots[placed[i]].used;
+						for (std::size_t j = 0; j < i && fits; ++j)
+							fits = placed[j] != placed[i];
+					}
+					if (!fits)
+						continue;
+
+					for (std::size_t i = 0; i < size; ++i)
+						result.slots[placed[i]] = entries[members[bucket][i]];
+					result.displacements[bucket] = displacement;
+					break;
+				}
+			}
+		}
+		return result;
+	}
+};
+
+// Unit lexicon.
+// Every accepted spelling of a unit (signature, aliases, SI prefixed forms)
+// is expanded at compile time into one table indexed by a perfect hash: a
+// lookup is two hashes and one comparison, whatever the number of names,
+// and never allocates.
+class unit_lexicon
+{
+public:
+	static std::optional<unit_name> find(std::string_view name)
+	{
+		const auto & slot = m_table.slots[m_table.slot_of(name)];
+		if (slot.used && slot.matches(name))
+			return unit_name{ slot.signature, slot.scale };
+		return std::nullopt;
+	}
+
+	// Slot of 'name' in the table, nullopt if unknown. Slots are constant
+	// for a build, so they serve as handles resolved once.
+	static std::optional<std::size_t> slot(std::string_view name)
+	{
+		auto index = m_table.slot_of(name);
+		const auto & slot = m_table.slots[index];
+		if (slot.used && slot.matches(name))
+			return index;
+		return std::nullopt;
+	}
+
+	// Unit of a slot returned by slot().
+	static unit_name at(std::size_t slot)
+	{
+		return unit_name{ m_table.slots[slot].signature, m_table.slots[slot].scale };
+	}
+
+	// Spelling of a slot returned by slot(), as prefix and name.
+	static std::pair<std::string_view, std::string_view> spelling(std::size_t slot)
+	{
+		return { m_table.slots[slot].prefix, m_table.slots[slot].name };
+	}
+
+	constexpr static std::size_t slot_count = unit_lexicon_table::table_size;
+
+private:
+	constexpr static unit_lexicon_table::table m_table = unit_lexicon_table::build();
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+
+/*
+ * Unit conversion library.
+ * C interface of the converter for in-process callers. Units are resolved
+ * once to handles, conversions between two handles are opened once, then
+ * batches of values are converted over arrays owned by the caller, without
+ * allocations nor locks. Every function may be called from any thread; a
+ * conversion may be shared between threads.
+ */
+
+#define UNITCONV_ABI_VERSION 1
+
+/* Decimals of the fixed point values: int64 counts of 10^-6 units. */
+#define UNITCONV_FIXED_DECIMALS 6
+
+#define UNITCONV_API __attribute__((visibility("default")))
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Status codes. */
+typedef enum unitconv_status
+{
+	UNITCONV_OK = 0,
+	UNITCONV_INVALID_ARGUMENT = 1,
+	UNITCONV_UNKNOWN_UNIT = 2,
+	/* Units of different dimensions. */
+	UNITCONV_INCOMPATIBLE = 3,
+	/* No fixed point form: a unit is not linear (dB, pH, awg, typek), or
+	 * the exact factors do not fit in int64 (such as Yg to yg). */
+	UNITCONV_NOT_EXACT = 4,
+	/* A fixed point result does not fit in int64. */
+	UNITCONV_OUT_OF_RANGE = 5,
+	UNITCONV_NO_MEMORY = 6
+} unitconv_status;
+
+/* Unit handle, 0 for none. Handles are valid for the library that gave
+ * them and must not be persisted. */
+typedef uint32_t unitconv_unit;
+
+/* Opened conversion between two units. */
+typedef struct unitconv_conversion unitconv_conversion;
+
+/* UNITCONV_ABI_VERSION of the library. */
+UNITCONV_API uint32_t unitconv_abi_version(void);
+
+/* Handle of a unit name, alias or SI prefixed form ("km", "pound"), 0 if
+ * unknown. 'name' needs not be terminated. */
+UNITCONV_API unitconv_unit unitconv_find_unit(const char * name, size_t length);
+
+/* Open the conversion of 'from' values to 'to'. */
+UNITCONV_API unitconv_status unitconv_open(unitconv_unit from, unitconv_unit to, unitconv_conversion ** conversion);
+
+UNITCONV_API void unitconv_close(unitconv_conversion * conversion);
+
+/* Convert 'count' floats, in place if 'values' == 'results'. Values outside
+ * the domain of a non-linear unit (dB of a ratio <= 0, typek beyond its
+ * table) give NaN. */
+UNITCONV_API unitconv_status unitconv_convert(const unitconv_conversion * conversion,
+	const float * values, float * results, size_t count);
+
+/* Convert 'count' fixed point values with exact factors, rounded half away
+ * from zero, giving the same results on every machine. In place if
+ * 'values' == 'results'. */
+UNITCONV_API unitconv_status unitconv_convert_fixed(const unitconv_conversion * conversion,
+	const int64_t * values, int64_t * results, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
@@ -6,75 +6,336 @@
 
 
 #include "pistache/endpoint.h"
+#include "pistache/router.h"
+#include "include/bulk_conversion.h"
+#include "include/chunked_stream.h"
 #include "include/converter.h"
+#include "include/fixed_point.h"
+#include "include/number_format.h"
+#include "include/number_parser.h"
+#include "include/request_arena.h"
+#include "include/static_files.h"
+#include "include/unit_expression.h"
 
 using namespace Pistache;
 
-class HelloHandler : public Http::Handler
+class ConvertService
 {
 public:
-    HTTP_PROTOTYPE(HelloHandler)
+	using Converter = converter<weight_metrics, distance_metrics, temperature_metrics, power_ratio_metrics, acidity_metrics>;
+	using Expressions = unit_expression<Converter>;
+	using ExactConverter = fixed_converter<Converter>;
 
-    void onRequest(const Http::Request& request, Http::ResponseWriter response)
+	// Body limit of the routes not taking uploads.
+	static constexpr size_t DefaultPayload = Const::DefaultMaxPayload;
+	// Body limit of bulk conversions, also the parser limit of the endpoint.
+	// The parser checks it before routing, so it bounds the head and body of
+	// every route: it is kept modest until limits can be set per route.
+	static constexpr size_t MaxPayload = 1024 * 1024;
+	// Deepest asset path served, in directories below 'static'.
+	static constexpr size_t MaxAssetDepth = 8;
+
+	ConvertService() : assets("static") { ; }
+
+	// Routes are published through a snapshot router, so they can be
+	// added or removed while the endpoint is serving.
+	void setupRoutes(Rest::SnapshotRouter & router)
+	{
+		using namespace Rest;
+
+		router.get("/convert", Routes::limitPayload(DefaultPayload, &ConvertService::convert, this));
+		router.post("/convert/bulk", Routes::limitPayload(MaxPayload, &ConvertService::convertBulk, this));
+		// A splat matches one segment only, so every nesting level of the
+		// assets gets its own route.
+		std::string assetRoute = "/static/*";
+		for (size_t depth = 0; depth <= MaxAssetDepth; ++depth, assetRoute += "/*")
+			router.get(assetRoute, Routes::limitPayload(DefaultPayload, &ConvertService::asset, this));
+		router.addNotFoundHandler(Routes::limitPayload(DefaultPayload, &ConvertService::unknown, this));
+	}
+
+	void convert(const Rest::Request& request, Http::ResponseWriter response)
 	{
 		using namespace Http;
 
-		// Check if GET method and "convert" command is used.
-		if (request.method() != Http::Method::Get ||
-			request.resource() != "/convert")
-		{
-			response.send(Pistache::Http::Code::Not_Implemented, "Unknown method or command used!");
-			return;
-		}
+		// Everything built for this request is allocated in the worker arena.
+		request_arena::scope arena;
 
-		// Fetch parameters.
-		std::string from, to, value;
+		// Fetch parameters, they stay owned by the request query.
+		std::string_view from, to, value, digits, exact;
 		for (auto it = request.query().parameters_begin(); it != request.query().parameters_end(); ++it)
 		{
-			auto parameter = *it;
-			auto[key, key_value] = parameter;
+			const auto & [key, key_value] = *it;
 			if (key == "from")
 				from = key_value;
 			else if (key == "to")
 				to = key_value;
 			else if (key == "value")
 				value = key_value;
+			else if (key == "digits")
+				digits = key_value;
+			else if (key == "exact")
+				exact = key_value;
+		}
+
+		// Shortest exact representation unless a number of decimals is asked.
+		auto format = number_format::parse(digits);
+		if (!format)
+		{
+			response.send(Pistache::Http::Code::Not_Implemented, "Invalid digits!");
+			return;
+		}
+
+		// Deterministic fixed point conversion.
+		if (exact == "1" || exact == "true")
+		{
+			convertExact(from, to, value, *format, arena, response);
+			return;
 		}
 
 		// Convert value to floating.
 		float from_value;
-		try
+		if (!number_parser::parse(value, from_value))
 		{
-			from_value = stof(value);
+			response.send(Pistache::Http::Code::Not_Implemented, "Invalid value!");
+			return;
 		}
-		catch (std::exception &)
+
+		// Several targets, 'to=*' or a comma separated list.
+		if (to == "*" || to.find(',') != std::string_view::npos)
 		{
-			response.send(Pistache::Http::Code::Not_Implemented, "Invalid value!");
+			convertMany(from, to, from_value, *format, arena, response);
 			return;
 		}
 
 		// Send JSON response.
-		auto result = converter<weight_metrics, distance_metrics, temperature_metrics>::instance()->process(from, to, from_value);
-		if (!result)
+		auto plan = Expressions::plan(from, to);
+		if (!plan)
 		{
 			response.send(Pistache::Http::Code::Not_Implemented, "Unknown conversion type!");
 			return;
 		}
-		
-		std::string json_response = "{\"result\":\"" + std::to_string(result.value()) + "\"}";
-		response.send(Pistache::Http::Code::Ok, json_response, MIME(Text, Plain));		
+
+		// Outside the domain of a non-linear unit (dB of a negative ratio).
+		float result = plan->convert(from_value);
+		if (!std::isfinite(result))
+		{
+			response.send(Pistache::Http::Code::Not_Implemented, "Invalid value!");
+			return;
+		}
+
+		std::pmr::string json_response("{\"result\":\"", arena.resource());
+		format->append(json_response, result);
+		json_response += "\"}";
+		response.send(Pistache::Http::Code::Ok, json_response.data(), json_response.size(), MIME(Text, Plain));
     }
+
+	// Conversion in fixed point, identical on every machine, sent as
+	// {"result":"<value>"} with every decimal of the fixed precision or
+	// rounded to 'digits'. Only linear units of the converter are accepted.
+	void convertExact(std::string_view from, std::string_view to, std::string_view value, const number_format& format,
+		const request_arena::scope& arena, Http::ResponseWriter& response)
+	{
+		using namespace Http;
+
+		ExactConverter::text::value_type from_value, result;
+		if (!ExactConverter::text::parse(value, from_value))
+		{
+			response.send(Pistache::Http::Code::Not_Implemented, "Invalid value!");
+			return;
+		}
+
+		auto plan = ExactConverter::plan(from, to);
+		if (!plan)
+		{
+			response.send(Pistache::Http::Code::Not_Implemented, "Unknown conversion type!");
+			return;
+		}
+		if (!plan->convert(from_value, result))
+		{
+			response.send(Pistache::Http::Code::Not_Implemented, "Value out of range!");
+			return;
+		}
+
+		std::pmr::string json_response("{\"result\":\"", arena.resource());
+		ExactConverter::text::append(json_response, result, format.digits());
+		json_response += "\"}";
+		response.send(Pistache::Http::Code::Ok, json_response.data(), json_response.size(), MIME(Text, Plain));
+	}
+
+	// Every requested target, sent as {"result":{"<unit>":"<value>",...}}.
+	// Computed from a single normalization of 'from': 'to=*' gives every
+	// unit of its dimension, a list may hold any unit or expression.
+	void convertMany(std::string_view from, std::string_view to, float value, const number_format& format,
+		const request_arena::scope& arena, Http::ResponseWriter& response)
+	{
+		using namespace Http;
+
+		// Every result of a list must be finite, see convert().
+		bool finite = true;
+		std::pmr::string json_response("{\"result\":{", arena.resource());
+		auto append = [&](std::string_view unit, float result)
+		{
+			finite = finite && std::isfinite(result);
+			if (json_response.back() != '{')
+				json_response += ',';
+			json_response += '"';
+			json_response += unit;
+			json_response += "\":\"";
+			format.append(json_response, result);
+			json_response += '"';
+		};
+
+		if (to == "*")
+		{
+			if (!Expressions::fan_out(from, value, append))
+			{
+				response.send(Pistache::Http::Code::Not_Implemented, "Unknown conversion type!");
+				return;
+			}
+			// Units outside their domain are left out, but 'from' itself
+			// must hold the value.
+			finite = json_response.back() != '{';
+		}
+		else
+		{
+			// Targets are answered under the name they were requested with.
+			if (!Expressions::convert_each(from, value, to, append))
+			{
+				response.send(Pistache::Http::Code::Not_Implemented, "Unknown conversion type!");
+				return;
+			}
+		}
+
+		if (!finite)
+		{
+			response.send(Pistache::Http::Code::Not_Implemented, "Invalid value!");
+			return;
+		}
+
+		json_response += "}}";
+		response.send(Pistache::Http::Code::Ok, json_response.data(), json_response.size(), MIME(Text, Plain));
+	}
+
+	// CSV or NDJSON document converted row by row, see bulk_conversion.
+	// Query parameters: 'format' (csv or ndjson, csv by default), 'from'
+	// and 'to' for rows not giving their units, and 'digits'.
+	void convertBulk(const Rest::Request& request, Http::ResponseWriter response)
+	{
+		using namespace Http;
+
+		auto digits = number_format::parse(request.query().get("digits").getOrElse(""));
+		if (!digits)
+		{
+			response.send(Code::Not_Implemented, "Invalid digits!");
+			return;
+		}
+
+		auto job = std::make_shared<BulkJob>(request, *digits);
+		response.headers().addRaw(Header::Raw("Content-Type",
+			job->format == BulkConversion::format::ndjson ? "application/x-ndjson" : "text/csv"));
+		job->stream = chunked_stream::open(response, Code::Ok);
+
+		// Nothing is sent before the handler returns. While the request
+		// body is there, convert as long as the output stays under the
+		// upload limit, so most documents are never copied.
+		std::string block;
+		while (!job->conversion.done() && job->stream->pending() < MaxPayload)
+		{
+			block.clear();
+			job->conversion.next(block);
+			job->stream->write(block);
+		}
+
+		// The request body goes away with this handler, a job left waiting
+		// for the client keeps what it has not converted yet.
+		job->keepRemaining();
+		pumpBulk(job);
+	}
+
+	// UI and documentation files, served from the 'static' directory.
+	void asset(const Rest::Request& request, Http::ResponseWriter response)
+	{
+		constexpr std::string_view prefix = "/static/";
+
+		auto resource = request.resource();
+		assets.serve(request, std::string_view(resource).substr(prefix.size()), response);
+	}
+
+	void unknown(const Rest::Request&, Http::ResponseWriter response)
+	{
+		response.send(Pistache::Http::Code::Not_Implemented, "Unknown method or command used!");
+	}
+
+private:
+	using BulkConversion = bulk_conversion<Converter>;
+
+	// Bulk conversion in progress. It reads the uploaded document from the
+	// request while the handler runs and only owns what is left of it when
+	// it has to wait for the client.
+	struct BulkJob
+	{
+		BulkJob(const Rest::Request& request, number_format digits) :
+			format(request.query().get("format").getOrElse("csv") == "ndjson" ?
+				BulkConversion::format::ndjson : BulkConversion::format::csv),
+			from(request.query().get("from").getOrElse("")),
+			to(request.query().get("to").getOrElse("")),
+			conversion(request.rawBody(), format, from, to, digits)
+		{
+			;
+		}
+
+		void keepRemaining()
+		{
+			if (conversion.done())
+				return;
+
+			rest.assign(conversion.remaining());
+			conversion.relocate(rest);
+		}
+
+		BulkConversion::format format;
+		std::string from;
+		std::string to;
+		BulkConversion conversion;
+		std::string rest;
+		std::shared_ptr<chunked_stream> stream;
+	};
+
+	// Convert block after block, waiting for the client whenever the stream
+	// backlog is over its high-water mark, so memory use stays bounded.
+	static void pumpBulk(std::shared_ptr<BulkJob> job)
+	{
+		std::string block;
+		while (!job->conversion.done())
+		{
+			block.clear();
+			job->conversion.next(block);
+			if (!job->stream->write(block) && !job->conversion.done())
+			{
+				job->stream->drained().then([job]() { pumpBulk(job); }, [](std::exception_ptr) { ; });
+				return;
+			}
+		}
+		job->stream->end();
+	}
+
+	static_files assets;
 };
 
 int main()
 {
     Pistache::Address addr(Pistache::Ipv4::any(), Pistache::Port(9080));
     auto opts = Pistache::Http::Endpoint::options()
-        .threads(1);
+        .threads(1)
+        .maxPayload(ConvertService::MaxPayload);
+
+    ConvertService service;
+    auto router = std::make_shared<Rest::SnapshotRouter>();
+    service.setupRoutes(*router);
 
     Http::Endpoint server(addr);
     server.init(opts);
-    server.setHandler(Http::make_handler<HelloHandler>());
+    server.setHandler(Rest::SnapshotRouter::handler(router));
     server.serve();
 
     server.shutdown();
@@ -0,0 +1,113 @@
+#include <new>
+#include <optional>
+#include <string>
+
+#include "include/converter.h"
+#include "include/fixed_point.h"
+#include "include/unit_expression.h"
+#include "include/unit_lexicon.h"
+#include "include/unitconv.h"
+
+
+
+namespace
+{
+	using unitconv_converter = converter<weight_metrics, distance_metrics, temperature_metrics, power_ratio_metrics, acidity_metrics>;
+	using unitconv_expressions = unit_expression<unitconv_converter>;
+	using unitconv_exact = fixed_converter<unitconv_converter, UNITCONV_FIXED_DECIMALS>;
+
+	// The singletons are created lazily, so they are created at load time
+	// before any caller thread can race on them.
+	const bool initialized = (unitconv_converter::instance(), converter_factory::instance(), true);
+
+	// Handles are lexicon slots shifted by one, 0 being none.
+	std::optional<std::string> spelling(unitconv_unit unit)
+	{
+		if (unit == 0 || unit > unit_lexicon::slot_count)
+			return std::nullopt;
+
+		auto [prefix, name] = unit_lexicon::spelling(unit - 1);
+		if (name.empty())
+			return std::nullopt;
+
+		std::string result(prefix);
+		result += name;
+		return result;
+	}
+}
+
+struct unitconv_conversion
+{
+	conversion_plan plan;
+	std::optional<unitconv_exact::plan_type> exact;
+};
+
+
+uint32_t unitconv_abi_version(void)
+{
+	return UNITCONV_ABI_VERSION;
+}
+
+unitconv_unit unitconv_find_unit(const char * name, size_t length)
+{
+	if (!name)
+		return 0;
+
+	auto slot = unit_lexicon::slot(std::string_view(name, length));
+	return slot ? static_cast<unitconv_unit>(*slot + 1) : 0;
+}
+
+unitconv_status unitconv_open(unitconv_unit from, unitconv_unit to, unitconv_conversion ** conversion)
+{
+	if (!conversion)
+		return UNITCONV_INVALID_ARGUMENT;
+	*conversion = nullptr;
+
+	auto from_name = spelling(from);
+	auto to_name = spelling(to);
+	if (!from_name || !to_name)
+		return UNITCONV_UNKNOWN_UNIT;
+
+	// Nothing may be thrown across the C interface.
+	try
+	{
+		auto plan = unitconv_expressions::plan(*from_name, *to_name);
+		if (!plan)
+			return UNITCONV_INCOMPATIBLE;
+
+		*conversion = new unitconv_conversion{ *plan, unitconv_exact::plan(*from_name, *to_name) };
+		return UNITCONV_OK;
+	}
+	catch (const std::bad_alloc &)
+	{
+		return UNITCONV_NO_MEMORY;
+	}
+	catch (...)
+	{
+		return UNITCONV_INCOMPATIBLE;
+	}
+}
+
+void unitconv_close(unitconv_conversion * conversion)
+{
+	delete conversion;
+}
+
+unitconv_status unitconv_convert(const unitconv_conversion * conversion, const float * values, float * results, size_t count)
+{
+	if (!conversion || (count && (!values || !results)))
+		return UNITCONV_INVALID_ARGUMENT;
+
+	conversion->plan.convert(values, results, count);
+	return UNITCONV_OK;
+}
+
+unitconv_status unitconv_convert_fixed(const unitconv_conversion * conversion, const int64_t * values, int64_t * results, size_t count)
+{
+	if (!conversion || (count && (!values || !results)))
+		return UNITCONV_INVALID_ARGUMENT;
+	if (!conversion->exact)
+		return UNITCONV_NOT_EXACT;
+
+	return conversion->exact->convert(values, results, count) ? UNITCONV_OK : UNITCONV_OUT_OF_RANGE;
+}
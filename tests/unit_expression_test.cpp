@@ -0,0 +1,124 @@
+/*
+   Multi-target conversions of unit_expression ('to=*' and target lists).
+*/
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "include/converter.h"
+#include "include/unit_expression.h"
+
+using Converter = converter<weight_metrics, distance_metrics, temperature_metrics, power_ratio_metrics, acidity_metrics>;
+using Expressions = unit_expression<Converter>;
+using Results = std::vector<std::pair<std::string, float>>;
+
+static int failures = 0;
+
+#define CHECK(condition) \
+	do { if (!(condition)) { std::printf("%s:%d: %s\n", __FILE__, __LINE__, #condition); ++failures; } } while (false)
+
+static bool near(float value, float expected)
+{
+	return std::fabs(value - expected) <= 1e-4f * std::fmax(1.f, std::fabs(expected));
+}
+
+static bool convert_each(std::string_view from, float value, std::string_view targets, Results & results)
+{
+	results.clear();
+	return Expressions::convert_each(from, value, targets, [&results](std::string_view unit, float result)
+	{
+		results.emplace_back(std::string(unit), result);
+	});
+}
+
+static bool fan_out(std::string_view from, float value, Results & results)
+{
+	results.clear();
+	return Expressions::fan_out(from, value, [&results](std::string_view unit, float result)
+	{
+		results.emplace_back(std::string(unit), result);
+	});
+}
+
+static const std::pair<std::string, float> * find(const Results & results, std::string_view unit)
+{
+	for (const auto & result : results)
+	{
+		if (result.first == unit)
+			return &result;
+	}
+	return nullptr;
+}
+
+static void test_every_unit()
+{
+	Results results;
+	CHECK(fan_out("m", 1.f, results));
+	CHECK(find(results, "awg") && find(results, "ft") && near(find(results, "ft")->second, 3.28084f));
+
+	// No wire gauge of a null diameter, the linear units are still given.
+	CHECK(fan_out("m", 0.f, results));
+	CHECK(!find(results, "awg"));
+	CHECK(find(results, "m") && find(results, "ml") && find(results, "ft") && near(find(results, "ft")->second, 0.f));
+
+	CHECK(fan_out("m", -1.f, results));
+	CHECK(!find(results, "awg") && find(results, "m"));
+
+	// Beyond the type K table.
+	CHECK(fan_out("c", 2000.f, results));
+	CHECK(!find(results, "typek"));
+	CHECK(find(results, "f") && near(find(results, "f")->second, 3632.f));
+	CHECK(find(results, "k") && near(find(results, "k")->second, 2273.15f));
+
+	// Outside the domain of 'from' itself.
+	CHECK(fan_out("typek", 100.f, results));
+	CHECK(results.empty());
+
+	CHECK(!fan_out("unknown", 1.f, results));
+}
+
+static void test_list()
+{
+	Results results;
+	CHECK(convert_each("c", 100.f, "f,k", results));
+	CHECK(results.size() == 2);
+	CHECK(results[0].first == "f" && near(results[0].second, 212.f));
+	CHECK(results[1].first == "k" && near(results[1].second, 373.15f));
+
+	// Derived units, prefixes and expressions of the same dimension.
+	CHECK(convert_each("ft", 1.f, "m,in,cm", results));
+	CHECK(results.size() == 3);
+	CHECK(near(results[0].second, 0.3048f) && near(results[1].second, 12.f) && near(results[2].second, 30.48f));
+
+	// Units without a dimension go through their group.
+	CHECK(convert_each("dB", 10.f, "ratio,dB", results));
+	CHECK(results.size() == 2 && near(results[0].second, 10.f) && near(results[1].second, 10.f));
+
+	CHECK(!convert_each("m", 1.f, "f", results));
+	CHECK(!convert_each("m", 1.f, "ft,unknown", results));
+}
+
+static void test_repeated_targets()
+{
+	Results results;
+	CHECK(convert_each("c", 0.f, "f,f", results));
+	CHECK(results.size() == 1 && results[0].first == "f" && near(results[0].second, 32.f));
+
+	CHECK(convert_each("c", 0.f, "f,k,f,k", results));
+	CHECK(results.size() == 2 && results[0].first == "f" && results[1].first == "k");
+}
+
+int main()
+{
+	test_every_unit();
+	test_list();
+	test_repeated_targets();
+
+	if (failures == 0)
+		std::printf("All tests passed\n");
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,28 @@
+# Fails if LIBRARY exports a symbol that is not unitconv_*.
+execute_process(COMMAND nm -D --defined-only ${LIBRARY}
+    OUTPUT_VARIABLE symbols
+    RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "nm failed on ${LIBRARY}")
+endif()
+
+string(REPLACE "\n" ";" symbols "${symbols}")
+set(exported 0)
+foreach(line IN LISTS symbols)
+    # "<address> <type> <name>", the version definition has type A.
+    if(line MATCHES "^[0-9a-fA-F]+ ([A-Za-z]) ([^ ]+)$")
+        set(type ${CMAKE_MATCH_1})
+        set(name ${CMAKE_MATCH_2})
+        if(type STREQUAL "A")
+            continue()
+        endif()
+        if(NOT name MATCHES "^unitconv_")
+            message(FATAL_ERROR "Unexpected exported symbol: ${name}")
+        endif()
+        math(EXPR exported "${exported} + 1")
+    endif()
+endforeach()
+
+if(exported EQUAL 0)
+    message(FATAL_ERROR "No unitconv_* symbol exported")
+endif()